@@ -77,6 +77,21 @@ class BigInteger {
     }
     return str;
   }
+  // Same text as toString(), written through `out.append` (char, integers)
+  // and `out.append_padded` so a StringBuilder needs no temporaries.
+  template <typename Sink>
+  void AppendTo(Sink& out) const {
+    if (sign_ == -1) {
+      out.append('-');
+    }
+    if (data_.empty()) {
+      return;
+    }
+    out.append(data_.back());
+    for (size_t i = data_.size() - 1; i > 0; --i) {
+      out.append_padded(data_[i - 1], 9);
+    }
+  }
   explicit operator bool() const { return (sign_ != 0); }
   size_t size() const { return data_.size(); }
   int sign() const { return sign_; }
@@ -455,6 +470,8 @@ class Rational {
   void CheckSign();
   void Simplify();
   std::string toString();
+  template <typename Sink>
+  void AppendTo(Sink& out);
   Rational& operator+=(const Rational& b);
   Rational& operator-=(const Rational& b);
   Rational& operator*=(const Rational& b);
@@ -571,6 +588,20 @@ std::string Rational::toString() {
   return str;
 }
 
+template <typename Sink>
+void Rational::AppendTo(Sink& out) {
+  CheckSign();
+  Simplify();
+  if (sign_ == -1) {
+    out.append('-');
+  }
+  numerator_.AppendTo(out);
+  if (denominator_ != 1) {
+    out.append('/');
+    denominator_.AppendTo(out);
+  }
+}
+
 bool operator==(const Rational& a, const Rational& b) {
   return ((a.sign() == b.sign()) && ((a.numerator() * b.denominator()) ==
                                      (a.denominator() * b.numerator())));
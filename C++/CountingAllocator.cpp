@@ -0,0 +1,240 @@
+#include <algorithm>
+#include <atomic>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+// Totals of one AllocationCounters, or of one thread's share of them.
+// histogram[i] counts allocations of at most 2^i bytes (and more than
+// 2^(i-1)); the last bucket takes everything larger.
+struct AllocationStats {
+  static constexpr size_t kBuckets = 32;
+
+  std::thread::id thread;
+  uint64_t allocations = 0;
+  uint64_t deallocations = 0;
+  uint64_t bytes_allocated = 0;
+  uint64_t bytes_deallocated = 0;
+  uint64_t peak_live_bytes = 0;
+  uint64_t histogram[kBuckets] = {};
+
+  uint64_t live_bytes() const { return bytes_allocated - bytes_deallocated; }
+};
+
+// Sink for CountingAllocator, shared by all allocators that record into it
+// the way StackStorage is shared by StackAllocators. Every thread records
+// into counters of its own, so counting adds no contention between threads
+// besides the single live-bytes total the peak is taken from. Memory freed
+// on another thread than it was allocated on shows up as deallocations of
+// that thread. The counters must outlive the allocators that use them.
+class AllocationCounters {
+ private:
+  struct ThreadCounters {
+    std::thread::id thread;
+    ThreadCounters* next;
+    std::atomic<uint64_t> allocations{0};
+    std::atomic<uint64_t> deallocations{0};
+    std::atomic<uint64_t> bytes_allocated{0};
+    std::atomic<uint64_t> bytes_deallocated{0};
+    std::atomic<uint64_t> histogram[AllocationStats::kBuckets] = {};
+  };
+
+  struct LocalCache {
+    uint64_t id = 0;
+    ThreadCounters* counters = nullptr;
+  };
+
+  static std::atomic<uint64_t>& NextId() {
+    static std::atomic<uint64_t> next_id{1};
+    return next_id;
+  }
+
+  const uint64_t id_ = NextId().fetch_add(1, std::memory_order_relaxed);
+  std::atomic<ThreadCounters*> threads_{nullptr};
+  std::atomic<uint64_t> live_{0};
+  std::atomic<uint64_t> peak_{0};
+
+  // Only the owning thread writes a counter, so a relaxed load and store
+  // are enough and readers never see a torn value.
+  static void Bump(std::atomic<uint64_t>& counter, uint64_t value) {
+    counter.store(counter.load(std::memory_order_relaxed) + value,
+                  std::memory_order_relaxed);
+  }
+
+  static size_t Bucket(size_t bytes) {
+    return std::min<size_t>(std::bit_width(std::max<size_t>(bytes, 1) - 1),
+                            AllocationStats::kBuckets - 1);
+  }
+
+  // Counters of the calling thread; the last ones used are cached per
+  // thread, keyed by id_ so that a new object at the same address misses.
+  ThreadCounters& Local() {
+    thread_local LocalCache cache;
+    if (cache.id == id_) {
+      return *cache.counters;
+    }
+    std::thread::id self = std::this_thread::get_id();
+    ThreadCounters* counters = threads_.load(std::memory_order_acquire);
+    while (counters != nullptr && counters->thread != self) {
+      counters = counters->next;
+    }
+    if (counters == nullptr) {
+      counters = new ThreadCounters;
+      counters->thread = self;
+      counters->next = threads_.load(std::memory_order_relaxed);
+      while (!threads_.compare_exchange_weak(counters->next, counters,
+                                             std::memory_order_release,
+                                             std::memory_order_relaxed)) {
+      }
+    }
+    cache.id = id_;
+    cache.counters = counters;
+    return *counters;
+  }
+
+  static void Collect(const ThreadCounters& counters, AllocationStats& stats) {
+    stats.allocations += counters.allocations.load(std::memory_order_relaxed);
+    stats.deallocations +=
+        counters.deallocations.load(std::memory_order_relaxed);
+    stats.bytes_allocated +=
+        counters.bytes_allocated.load(std::memory_order_relaxed);
+    stats.bytes_deallocated +=
+        counters.bytes_deallocated.load(std::memory_order_relaxed);
+    for (size_t i = 0; i < AllocationStats::kBuckets; ++i) {
+      stats.histogram[i] +=
+          counters.histogram[i].load(std::memory_order_relaxed);
+    }
+  }
+
+ public:
+  AllocationCounters() {}
+
+  ~AllocationCounters() {
+    ThreadCounters* counters = threads_.load(std::memory_order_acquire);
+    while (counters != nullptr) {
+      ThreadCounters* next = counters->next;
+      delete counters;
+      counters = next;
+    }
+  }
+
+  AllocationCounters(const AllocationCounters& other) = delete;
+  AllocationCounters& operator=(const AllocationCounters& other) = delete;
+
+  void record_allocate(size_t bytes) {
+    ThreadCounters& counters = Local();
+    Bump(counters.allocations, 1);
+    Bump(counters.bytes_allocated, bytes);
+    Bump(counters.histogram[Bucket(bytes)], 1);
+    uint64_t live = live_.fetch_add(bytes, std::memory_order_relaxed) + bytes;
+    uint64_t peak = peak_.load(std::memory_order_relaxed);
+    while (live > peak && !peak_.compare_exchange_weak(
+                              peak, live, std::memory_order_relaxed)) {
+    }
+  }
+
+  void record_deallocate(size_t bytes) {
+    ThreadCounters& counters = Local();
+    Bump(counters.deallocations, 1);
+    Bump(counters.bytes_deallocated, bytes);
+    live_.fetch_sub(bytes, std::memory_order_relaxed);
+  }
+
+  // Sums over all threads; exact once the recording threads are quiet.
+  AllocationStats stats() const {
+    AllocationStats stats;
+    ThreadCounters* counters = threads_.load(std::memory_order_acquire);
+    for (; counters != nullptr; counters = counters->next) {
+      Collect(*counters, stats);
+    }
+    stats.peak_live_bytes = peak_.load(std::memory_order_relaxed);
+    return stats;
+  }
+
+  // One entry per thread that has recorded anything; peak_live_bytes is
+  // only tracked in total and stays 0 here.
+  std::vector<AllocationStats> per_thread() const {
+    std::vector<AllocationStats> result;
+    ThreadCounters* counters = threads_.load(std::memory_order_acquire);
+    for (; counters != nullptr; counters = counters->next) {
+      result.emplace_back();
+      result.back().thread = counters->thread;
+      Collect(*counters, result.back());
+    }
+    return result;
+  }
+
+  uint64_t live_bytes() const { return live_.load(std::memory_order_relaxed); }
+  uint64_t peak_live_bytes() const {
+    return peak_.load(std::memory_order_relaxed);
+  }
+};
+
+// Forwards is_splittable from the wrapped allocator, so that List batches
+// node allocations exactly as it would without the adaptor.
+template <typename Base, typename = void>
+struct SplittableFrom {};
+
+template <typename Base>
+struct SplittableFrom<Base, std::void_t<typename Base::is_splittable>> {
+  using is_splittable = typename Base::is_splittable;
+};
+
+// Allocator adaptor that forwards to Base and records every allocation in
+// an AllocationCounters. Rebinding keeps the counters, so one set of
+// counters sees everything a container allocates (nodes of List, cells and
+// the map of Deque, the control block of allocateShared).
+template <typename T, typename Base = std::allocator<T>>
+struct CountingAllocator : SplittableFrom<Base> {
+  using value_type = T;
+  using type = T;
+  using size_type = std::size_t;
+  using difference_type = std::ptrdiff_t;
+  using BaseTraits = std::allocator_traits<Base>;
+  using propagate_on_container_copy_assignment = std::true_type;
+  using propagate_on_container_move_assignment = std::true_type;
+  using propagate_on_container_swap = std::true_type;
+
+  [[no_unique_address]] Base base_;
+  AllocationCounters* counters_;
+
+  CountingAllocator(AllocationCounters& counters, const Base& base = Base())
+      : base_(base), counters_(&counters) {}
+
+  template <typename U, typename UBase>
+  CountingAllocator(const CountingAllocator<U, UBase>& other)
+      : base_(other.base_), counters_(other.counters_) {}
+
+  T* allocate(size_t count) {
+    T* ptr = BaseTraits::allocate(base_, count);
+    counters_->record_allocate(count * sizeof(T));
+    return ptr;
+  }
+
+  void deallocate(T* ptr, size_t count) {
+    counters_->record_deallocate(count * sizeof(T));
+    BaseTraits::deallocate(base_, ptr, count);
+  }
+
+  template <typename U>
+  struct rebind {
+    using other =
+        CountingAllocator<U, typename BaseTraits::template rebind_alloc<U>>;
+  };
+};
+
+template <typename T, typename TBase, typename U, typename UBase>
+bool operator==(const CountingAllocator<T, TBase>& first,
+                const CountingAllocator<U, UBase>& second) {
+  return first.counters_ == second.counters_ && first.base_ == second.base_;
+}
+
+template <typename T, typename TBase, typename U, typename UBase>
+bool operator!=(const CountingAllocator<T, TBase>& first,
+                const CountingAllocator<U, UBase>& second) {
+  return !(first == second);
+}
@@ -1,22 +1,28 @@
 #include <stddef.h>
 
+#include <memory>
 #include <stdexcept>
 
 template <typename T, bool IsConst>
 class DequeIterator;
 
-template <typename T>
+template <typename T, typename Alloc = std::allocator<T>>
 class Deque {
  private:
   template <typename, bool>
   friend class DequeIterator;
+  using AllocTraits = std::allocator_traits<Alloc>;
+  using MapAlloc = typename AllocTraits::template rebind_alloc<T*>;
+  using MapTraits = typename AllocTraits::template rebind_traits<T*>;
   static const int64_t kCell_size_ = 32;  // elements in one cell
+  [[no_unique_address]] Alloc alloc_;
   T** deque_;
   int64_t size_ = 0;
   int64_t capacity_ = 0;     // amount of cells
   int64_t start_ = 0;        // cell
   int64_t start_point_ = 0;  // index in cell
 
+  // Exchanges the storage but not the allocators.
   void Swap(Deque& another) {
     std::swap(capacity_, another.capacity_);
     std::swap(size_, another.size_);
@@ -25,104 +31,144 @@ class Deque {
     std::swap(deque_, another.deque_);
   }
 
+  T* Slot(int64_t index) const {
+    return deque_[start_ + (start_point_ + index) / kCell_size_] +
+           (start_point_ + index) % kCell_size_;
+  }
+
+  // Allocates a map of `capacity` cells; the cells of [keep, keep + kept)
+  // are left for the caller to fill in, all others get fresh memory.
+  T** AllocateMap(int64_t capacity, int64_t keep = 0, int64_t kept = 0) {
+    MapAlloc map_alloc(alloc_);
+    T** map = MapTraits::allocate(map_alloc, capacity);
+    int64_t j = 0;
+    try {
+      for (; j < capacity; ++j) {
+        if (j == keep && kept > 0) {
+          j += kept - 1;
+          continue;
+        }
+        map[j] = AllocTraits::allocate(alloc_, kCell_size_);
+      }
+    } catch (...) {
+      for (int64_t i = 0; i < j; ++i) {
+        if (i < keep || i >= keep + kept) {
+          AllocTraits::deallocate(alloc_, map[i], kCell_size_);
+        }
+      }
+      MapTraits::deallocate(map_alloc, map, capacity);
+      throw;
+    }
+    return map;
+  }
+
+  void DeallocateMap(T** map, int64_t capacity) {
+    for (int64_t j = 0; j < capacity; ++j) {
+      AllocTraits::deallocate(alloc_, map[j], kCell_size_);
+    }
+    MapAlloc map_alloc(alloc_);
+    MapTraits::deallocate(map_alloc, map, capacity);
+  }
+
+  // Moves the existing cells to index `offset` of a map of `new_capacity`
+  // cells; only the cells around them are newly allocated.
+  void Remap(int64_t new_capacity, int64_t offset) {
+    T** new_deque_ = AllocateMap(new_capacity, offset, capacity_);
+    std::copy(deque_, deque_ + capacity_, new_deque_ + offset);
+    MapAlloc map_alloc(alloc_);
+    MapTraits::deallocate(map_alloc, deque_, capacity_);
+    deque_ = new_deque_;
+    capacity_ = new_capacity;
+    start_ += offset;
+  }
+
+  void DestroyPrefix(int64_t count) {
+    for (int64_t j = 0; j < count; ++j) {
+      AllocTraits::destroy(alloc_, Slot(j));
+    }
+  }
+
  public:
   using iterator = DequeIterator<T, false>;
   using const_iterator = DequeIterator<T, true>;
   using reverse_iterator = std::reverse_iterator<iterator>;
   using reverse_const_iterator = std::reverse_iterator<const_iterator>;
-  Deque() : deque_(new T*[1]), capacity_(3) {
-    for (int i = 0; i < capacity_; ++i) {
-      deque_[i] = reinterpret_cast<T*>(new char[sizeof(T) * kCell_size_]);
-    }
+  Deque(const Alloc& alloc = Alloc()) : alloc_(alloc), capacity_(3) {
+    deque_ = AllocateMap(capacity_);
   }
-  Deque(const int64_t count)
-      : deque_(new T*[3 * count / kCell_size_ + 3]),
-        size_(count),
-        capacity_(3 * count / kCell_size_ + 3) {
-    for (int64_t i = 0; i < capacity_; ++i) {
-      deque_[i] = reinterpret_cast<T*>(new char[sizeof(T) * kCell_size_]);
-    }
-    int64_t builded = 0;
+  Deque(const int64_t count, const Alloc& alloc = Alloc())
+      : alloc_(alloc), capacity_(3 * count / kCell_size_ + 3) {
+    deque_ = AllocateMap(capacity_);
     try {
-      for (int64_t i = 0; i < capacity_; ++i) {
-        for (int64_t j = 0; j < kCell_size_; ++j) {
-          ++builded;
-          new (deque_[i] + j) T();
-        }
+      for (; size_ < count; ++size_) {
+        AllocTraits::construct(alloc_, Slot(size_));
       }
     } catch (...) {
-      for (int64_t j = 1; j < builded; ++j) {
-        (deque_[start_ + (start_point_ + j) / kCell_size_] +
-         (start_point_ + j) % kCell_size_)
-            ->~T();
-      }
-      for (int64_t j = 0; j < capacity_; ++j) {
-        delete[] reinterpret_cast<char*>(deque_[j]);
-      }
-      delete[] deque_;
+      DestroyPrefix(size_);
+      DeallocateMap(deque_, capacity_);
       throw;
     }
   }
 
-  Deque(int count, const T& value)
-      : deque_(new T*[3 * count / kCell_size_ + 3]),
-        size_(count),
-        capacity_(3 * count / kCell_size_ + 3) {
+  Deque(int count, const T& value, const Alloc& alloc = Alloc())
+      : alloc_(alloc), capacity_(3 * count / kCell_size_ + 3) {
+    deque_ = AllocateMap(capacity_);
     try {
-      for (int64_t i = 0; i < capacity_; ++i) {
-        deque_[i] = reinterpret_cast<T*>(new char[sizeof(T) * kCell_size_]);
-      }
-      for (int64_t i = 0; i < size_; ++i) {
-        new (deque_[i / kCell_size_] + i % kCell_size_) T(value);
+      for (; size_ < count; ++size_) {
+        AllocTraits::construct(alloc_, Slot(size_), value);
       }
     } catch (...) {
-      for (int64_t i = 0; i < capacity_; ++i) {
-        delete[] reinterpret_cast<char*>(deque_[i]);
-      }
-      delete[] deque_;
+      DestroyPrefix(size_);
+      DeallocateMap(deque_, capacity_);
       throw;
     }
   }
 
-  Deque(const Deque& another) {
-    T** new_deque_ = new T*[another.capacity_];
-    int64_t i = 0;
-    int64_t new_capacity_ = another.capacity_;
-    int64_t new_start_ = another.start_;
-    int64_t new_start_point_ = another.start_point_;
-    size_ = another.size_;
-    capacity_ = new_capacity_;
-    start_ = new_start_;
-    start_point_ = new_start_point_;
+  Deque(const Deque& another)
+      : Deque(another, AllocTraits::select_on_container_copy_construction(
+                           another.alloc_)) {}
+
+  Deque(const Deque& another, const Alloc& alloc)
+      : alloc_(alloc),
+        capacity_(another.capacity_),
+        start_(another.start_),
+        start_point_(another.start_point_) {
+    deque_ = AllocateMap(capacity_);
     try {
-      for (int64_t j = 0; j < new_capacity_; ++j) {
-        new_deque_[j] = reinterpret_cast<T*>(new char[sizeof(T) * kCell_size_]);
-      }
-      for (; i < size_; ++i) {
-        new (new_deque_[new_start_ + i / kCell_size_] + i % kCell_size_)
-            T(*(another.deque_[another.start_ +
-                               (another.start_point_ + i) / kCell_size_] +
-                (another.start_point_ + i) % kCell_size_));
+      for (; size_ < another.size_; ++size_) {
+        AllocTraits::construct(alloc_, Slot(size_), *another.Slot(size_));
       }
     } catch (...) {
-      for (int64_t j = 0; j < i; ++j) {
-        (new_deque_[new_start_ + j / kCell_size_] + j % kCell_size_)->~T();
-      }
-      for (int64_t j = 0; j < new_capacity_; ++j) {
-        delete[] reinterpret_cast<char*>(new_deque_[j]);
-      }
-      delete[] new_deque_;
+      DestroyPrefix(size_);
+      DeallocateMap(deque_, capacity_);
       throw;
     }
-    deque_ = new_deque_;
   }
 
   Deque& operator=(const Deque& another) {
-    Deque temp(another);
-    Swap(temp);
+    if (this == &another) {
+      return *this;
+    }
+    if constexpr (AllocTraits::propagate_on_container_copy_assignment::value) {
+      Deque temp(another, another.alloc_);
+      Swap(temp);
+      std::swap(alloc_, temp.alloc_);
+    } else {
+      Deque temp(another, alloc_);
+      Swap(temp);
+    }
     return *this;
   }
 
+  // Allocators are exchanged only when they propagate on swap, and
+  // otherwise must compare equal.
+  void swap(Deque& another) {
+    Swap(another);
+    if constexpr (AllocTraits::propagate_on_container_swap::value) {
+      std::swap(alloc_, another.alloc_);
+    }
+  }
+
   size_t size() const { return size_; }
 
   T& operator[](int64_t index) {
@@ -153,75 +199,36 @@ class Deque {
   void push_back(const T& value) {
     if (start_ * kCell_size_ + start_point_ + size_ >=
         capacity_ * kCell_size_) {
-      T** new_deque_ = new T*[capacity_ * 3 + 3];
-      int64_t new_capacity_ = capacity_ * 3 + 3;
-      int64_t new_start_ = capacity_;
-      try {
-        for (int64_t j = 0; j < new_capacity_; ++j) {
-          new_deque_[j] =
-              reinterpret_cast<T*>(new char[sizeof(T) * kCell_size_]);
-        }
-        std::copy(deque_ + start_, deque_ + start_ + size_ / kCell_size_,
-                  new_deque_ + new_start_);
-        *(new_deque_[new_start_ + size_ / kCell_size_] + size_ % kCell_size_) =
-            T(value);
-      } catch (...) {
-        delete[] new_deque_;
-        throw;
-      }
-      delete[] deque_;
-      deque_ = new_deque_;
-      capacity_ = new_capacity_;
-      start_ = new_start_;
-    } else {
-      new (deque_[start_ + (start_point_ + size_) / kCell_size_] +
-           (start_point_ + size_) % kCell_size_) T(value);
+      Remap(capacity_ * 3 + 3, capacity_);
     }
+    AllocTraits::construct(alloc_, Slot(size_), value);
     ++size_;
   };
 
   void pop_back() {
     --size_;
-    (deque_[start_ + (size_ + start_point_) / kCell_size_] +
-     (size_ + start_point_) % kCell_size_)
-        ->~T();
+    AllocTraits::destroy(alloc_, Slot(size_));
   };
 
   void push_front(const T& value) {
     if (start_ == 0 && start_point_ == 0) {
-      T** new_deque_ = new T*[capacity_ * 3];
-      int64_t new_capacity_ = capacity_ * 3;
-      int64_t new_start_ = capacity_;
-      int64_t new_start_point_ = kCell_size_ - 1;
-      try {
-        for (int64_t j = 0; j < new_capacity_; ++j) {
-          new_deque_[j] =
-              reinterpret_cast<T*>(new char[sizeof(T) * kCell_size_]);
-        }
-        new (new_deque_[new_start_] + new_start_point_) T(value);
-        std::copy(deque_, deque_ + capacity_, new_deque_ + capacity_ + 1);
-      } catch (...) {
-        delete[] new_deque_;
-        throw;
-      }
-      delete[] deque_;
-      deque_ = new_deque_;
-      capacity_ = new_capacity_;
-      start_ = new_start_;
-      start_point_ = new_start_point_;
-    } else {
-      --start_point_;
-      if (start_point_ < 0) {
-        start_point_ = kCell_size_ - 1;
-        --start_;
-      }
-      new (deque_[start_] + start_point_) T(value);
+      Remap(capacity_ * 3, capacity_);
+    }
+    int64_t new_start_ = start_;
+    int64_t new_start_point_ = start_point_ - 1;
+    if (new_start_point_ < 0) {
+      new_start_point_ = kCell_size_ - 1;
+      --new_start_;
     }
+    AllocTraits::construct(alloc_, deque_[new_start_] + new_start_point_,
+                           value);
+    start_ = new_start_;
+    start_point_ = new_start_point_;
     ++size_;
   };
   void pop_front() {
     --size_;
-    (deque_[start_] + start_point_)->~T();
+    AllocTraits::destroy(alloc_, deque_[start_] + start_point_);
     ++start_point_;
     if (start_point_ >= kCell_size_) {
       start_point_ = 0;
@@ -291,22 +298,13 @@ class Deque {
               (start_point_ + index + shift) % kCell_size_);
       }
     }
-    (deque_[start_ + (start_point_ + size_ - 1) / kCell_size_] +
-     (start_point_ + size_ - 1) % kCell_size_)
-        ->~T();
+    AllocTraits::destroy(alloc_, Slot(size_ - 1));
     --size_;
   }
 
   ~Deque() {
-    for (int64_t j = 0; j < size_; ++j) {
-      (deque_[start_ + (start_point_ + j) / kCell_size_] +
-       (start_point_ + j) % kCell_size_)
-          ->~T();
-    }
-    for (int64_t j = 0; j < capacity_; ++j) {
-      delete[] reinterpret_cast<char*>(deque_[j]);
-    }
-    delete[] deque_;
+    DestroyPrefix(size_);
+    DeallocateMap(deque_, capacity_);
   };
 };
 
@@ -326,7 +324,8 @@ class DequeIterator {
   using pointer = Type*;
   using reference = Type&;
   using value_type = Type;
-  DequeIterator(const Deque<T>& deque)
+  template <typename Alloc>
+  DequeIterator(const Deque<T, Alloc>& deque)
       : start_ptr_(deque.deque_ + deque.start_),
         start_point_ptr_(*(deque.deque_ + deque.start_) + deque.start_point_),
         cell_ptr_(deque.deque_ + deque.start_),
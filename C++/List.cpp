@@ -1,17 +1,112 @@
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <iterator>
+#include <functional>
+#include <initializer_list>
 #include <memory>
+#include <new>
+#include <stdexcept>
 #include <type_traits>
+#include <utility>
 
+// Monotonic arena: allocations bump through the inline `pool` and are never
+// reused. Once `pool` is full, further allocations come from a chain of heap
+// blocks (each twice the size of the previous one) that lives until the
+// storage is destroyed. The counters tell how big N must be for a workload:
+// used() is what the arena consumed, overflow_used() the part that did not
+// fit inline, and high_water() the peak of live (not yet deallocated) bytes.
 template <size_t N>
 struct StackStorage {
+  struct OverflowBlock {
+    OverflowBlock* prev;
+    size_t size;
+  };
+  static constexpr size_t kHeader =
+      (sizeof(OverflowBlock) + alignof(std::max_align_t) - 1) /
+      alignof(std::max_align_t) * alignof(std::max_align_t);
+
   char pool[N];
   size_t shift;
+  OverflowBlock* overflow_ = nullptr;
+  size_t overflow_shift_ = 0;
+  size_t overflow_used_ = 0;
+  size_t overflow_blocks_ = 0;
+  size_t live_ = 0;
+  size_t high_water_ = 0;
 
   StackStorage() : shift(0) {}
 
-  ~StackStorage() {}
+  ~StackStorage() {
+    while (overflow_ != nullptr) {
+      OverflowBlock* prev = overflow_->prev;
+      ::operator delete(overflow_);
+      overflow_ = prev;
+    }
+  }
 
   StackStorage(const StackStorage& other) = delete;
   StackStorage& operator=(const StackStorage& other) = delete;
+
+  // Bumps `offset` through [base, base + size); nullptr if it does not fit.
+  static void* Bump(char* base, size_t size, size_t& offset, size_t bytes,
+                    size_t alignment) {
+    void* current = base + offset;
+    size_t space = size - offset;
+    if (std::align(alignment, bytes, current, space) == nullptr) {
+      return nullptr;
+    }
+    offset = static_cast<char*>(current) - base + bytes;
+    return current;
+  }
+
+  static char* Data(OverflowBlock* block) {
+    return reinterpret_cast<char*>(block) + kHeader;
+  }
+
+  void* AllocateOverflow(size_t bytes, size_t alignment) {
+    size_t before = overflow_shift_;
+    void* block = nullptr;
+    if (overflow_ != nullptr) {
+      block = Bump(Data(overflow_), overflow_->size, overflow_shift_, bytes,
+                   alignment);
+    }
+    if (block == nullptr) {
+      size_t size = overflow_ == nullptr ? std::max<size_t>(N, 4096)
+                                         : 2 * overflow_->size;
+      size = std::max(size, bytes + alignment);
+      OverflowBlock* next =
+          static_cast<OverflowBlock*>(::operator new(kHeader + size));
+      next->prev = overflow_;
+      next->size = size;
+      overflow_ = next;
+      overflow_shift_ = before = 0;
+      ++overflow_blocks_;
+      block = Bump(Data(overflow_), size, overflow_shift_, bytes, alignment);
+    }
+    overflow_used_ += overflow_shift_ - before;
+    return block;
+  }
+
+  void* allocate(size_t bytes, size_t alignment) {
+    void* block = Bump(pool, N, shift, bytes, alignment);
+    if (block == nullptr) {
+      block = AllocateOverflow(bytes, alignment);
+    }
+    live_ += bytes;
+    high_water_ = std::max(high_water_, live_);
+    return block;
+  }
+
+  // The memory itself is reclaimed only with the storage.
+  void deallocate(size_t bytes) { live_ -= bytes; }
+
+  size_t used() const { return shift + overflow_used_; }
+  size_t overflow_used() const { return overflow_used_; }
+  size_t overflow_blocks() const { return overflow_blocks_; }
+  size_t live() const { return live_; }
+  size_t high_water() const { return high_water_; }
 };
 
 template <typename T, size_t N>
@@ -20,6 +115,7 @@ struct StackAllocator {
   using type = T;
   using size_type = std::size_t;
   using difference_type = std::ptrdiff_t;
+  using is_splittable = std::true_type;  // deallocate only counts bytes
 
   StackStorage<N>* storage_;
 
@@ -39,16 +135,12 @@ struct StackAllocator {
   ~StackAllocator() = default;
 
   T* allocate(size_t count) {
-    size_t space = N - storage_->shift;
-    void* current = static_cast<void*>(storage_->pool + storage_->shift);
-    void* prev = current;
-    std::align(alignof(T), sizeof(T), current, space);
-    storage_->shift += count * sizeof(T) +
-                       (static_cast<char*>(current) - static_cast<char*>(prev));
-    return static_cast<T*>(current);
+    return static_cast<T*>(storage_->allocate(count * sizeof(T), alignof(T)));
   }
 
-  void deallocate(T* ptr, size_t) { std::ignore = ptr; }
+  void deallocate(T*, size_t count) {
+    storage_->deallocate(count * sizeof(T));
+  }
 
   template <typename U>
   struct rebind {
@@ -56,6 +148,155 @@ struct StackAllocator {
   };
 };
 
+template <typename T, typename U, size_t N>
+bool operator==(const StackAllocator<T, N>& first,
+                const StackAllocator<U, N>& second) {
+  return first.storage_ == second.storage_;
+}
+
+template <typename T, typename U, size_t N>
+bool operator!=(const StackAllocator<T, N>& first,
+                const StackAllocator<U, N>& second) {
+  return !(first == second);
+}
+
+// An allocator is splittable (member type is_splittable = true_type) if the
+// elements of one allocate(n) block may be given back one at a time with
+// deallocate(ptr + i, 1). List then takes all nodes of a batched insertion
+// from a single allocation.
+template <typename Alloc, typename = void>
+struct IsSplittable : std::false_type {};
+
+template <typename Alloc>
+struct IsSplittable<Alloc, std::void_t<typename Alloc::is_splittable>>
+    : Alloc::is_splittable {};
+
+// Recycling arena: blocks are carved from heap chunks and, when freed, go to
+// a free list for their size class (multiples of kGranularity bytes), where
+// the next allocation of that class picks them up. Long-lived containers
+// with constant insert/erase churn therefore stay at their peak live size.
+// Requests above the largest class, or more aligned than kGranularity, go
+// to operator new directly. Chunks are returned to the system only when the
+// storage is destroyed. Not thread-safe, like StackStorage.
+class PoolStorage {
+ private:
+  static constexpr size_t kGranularity = alignof(std::max_align_t);
+  static constexpr size_t kClasses = 16;
+  static constexpr size_t kChunkSize = 64 * 1024;
+
+  struct FreeBlock {
+    FreeBlock* next;
+  };
+  struct Chunk {
+    Chunk* prev;
+  };
+
+  FreeBlock* free_[kClasses] = {};
+  Chunk* chunks_ = nullptr;
+  char* cursor_ = nullptr;
+  char* limit_ = nullptr;
+
+  static size_t ClassOf(size_t bytes) {
+    return (std::max(bytes, size_t(1)) - 1) / kGranularity;
+  }
+
+  static bool Pooled(size_t bytes, size_t alignment) {
+    return ClassOf(bytes) < kClasses && alignment <= kGranularity;
+  }
+
+  void* Carve(size_t bytes) {
+    if (static_cast<size_t>(limit_ - cursor_) < bytes) {
+      // the rest of the old chunk is left unused
+      Chunk* chunk = static_cast<Chunk*>(::operator new(kChunkSize));
+      chunk->prev = chunks_;
+      chunks_ = chunk;
+      cursor_ = reinterpret_cast<char*>(chunk) + kGranularity;
+      limit_ = reinterpret_cast<char*>(chunk) + kChunkSize;
+    }
+    void* block = cursor_;
+    cursor_ += bytes;
+    return block;
+  }
+
+ public:
+  PoolStorage() {}
+
+  ~PoolStorage() {
+    while (chunks_ != nullptr) {
+      Chunk* prev = chunks_->prev;
+      ::operator delete(chunks_);
+      chunks_ = prev;
+    }
+  }
+
+  PoolStorage(const PoolStorage& other) = delete;
+  PoolStorage& operator=(const PoolStorage& other) = delete;
+
+  void* allocate(size_t bytes, size_t alignment) {
+    if (!Pooled(bytes, alignment)) {
+      return ::operator new(bytes, std::align_val_t(alignment));
+    }
+    size_t size_class = ClassOf(bytes);
+    if (FreeBlock* block = free_[size_class]) {
+      free_[size_class] = block->next;
+      return block;
+    }
+    return Carve((size_class + 1) * kGranularity);
+  }
+
+  void deallocate(void* ptr, size_t bytes, size_t alignment) {
+    if (!Pooled(bytes, alignment)) {
+      ::operator delete(ptr, std::align_val_t(alignment));
+      return;
+    }
+    size_t size_class = ClassOf(bytes);
+    FreeBlock* block = static_cast<FreeBlock*>(ptr);
+    block->next = free_[size_class];
+    free_[size_class] = block;
+  }
+};
+
+template <typename T>
+struct PoolAllocator {
+  using value_type = T;
+  using type = T;
+  using size_type = std::size_t;
+  using difference_type = std::ptrdiff_t;
+
+  PoolStorage* storage_;
+
+  PoolAllocator(PoolStorage& main_storage) : storage_(&main_storage) {}
+
+  template <typename U>
+  PoolAllocator(const PoolAllocator<U>& other) : storage_(other.storage_) {}
+
+  T* allocate(size_t count) {
+    return static_cast<T*>(
+        storage_->allocate(count * sizeof(T), alignof(T)));
+  }
+
+  void deallocate(T* ptr, size_t count) {
+    storage_->deallocate(ptr, count * sizeof(T), alignof(T));
+  }
+
+  template <typename U>
+  struct rebind {
+    using other = PoolAllocator<U>;
+  };
+};
+
+template <typename T, typename U>
+bool operator==(const PoolAllocator<T>& first,
+                const PoolAllocator<U>& second) {
+  return first.storage_ == second.storage_;
+}
+
+template <typename T, typename U>
+bool operator!=(const PoolAllocator<T>& first,
+                const PoolAllocator<U>& second) {
+  return !(first == second);
+}
+
 template <typename T>
 struct BaseNode;
 
@@ -80,6 +321,9 @@ struct Node : private BaseNode<T> {
   T value;
   Node() : BaseNode<T>(nullptr, nullptr) {}
   Node(const T& value) : BaseNode<T>(nullptr, nullptr), value(value) {}
+  template <typename... Args>
+  Node(std::in_place_t, Args&&... args)
+      : BaseNode<T>(nullptr, nullptr), value(std::forward<Args>(args)...) {}
   ~Node() {}
 };
 
@@ -157,78 +401,191 @@ class List {
   size_t size_ = 0;
   BaseNode<T> fakeNode;
 
- public:
-  using iterator = NodeIterator<T, false>;
-  using const_iterator = NodeIterator<T, true>;
-  using reverse_iterator = std::reverse_iterator<iterator>;
-  using const_reverse_iterator = std::reverse_iterator<const_iterator>;
-  [[no_unique_address]] NodeAllocator node_alloc;
+  // Nodes can move between lists only if either allocator frees the other's.
+  bool SameAllocator(const List& other) const {
+    if constexpr (NodeAllocator_traits::is_always_equal::value) {
+      return true;
+    } else {
+      return node_alloc == other.node_alloc;
+    }
+  }
 
-  List() {}
+  // Detaches the chain [first, last] from its list.
+  static void Unlink(BaseNode<T>* first, BaseNode<T>* last) {
+    first->prev->next = last->next;
+    last->next->prev = first->prev;
+  }
 
-  List(const size_t count) {
-    for (size_t i = 0; i < count; ++i) {
-      Node<T>* ptr = NodeAllocator_traits::allocate(node_alloc, 1);
-      try {
-        NodeAllocator_traits::construct(node_alloc, ptr);
-      } catch (...) {
-        NodeAllocator_traits::deallocate(node_alloc, ptr, 1);
-        this->~List();
-        throw;
+  // Links the detached chain [first, last] in front of `pos`.
+  static void LinkBefore(BaseNode<T>* pos, BaseNode<T>* first,
+                         BaseNode<T>* last) {
+    first->prev = pos->prev;
+    last->next = pos;
+    pos->prev->next = first;
+    pos->prev = last;
+  }
+
+  // Merges two null-terminated chains linked through `next` only; on ties
+  // nodes of `first` come first.
+  template <typename Compare>
+  static BaseNode<T>* MergeRuns(BaseNode<T>* first, BaseNode<T>* second,
+                                Compare& comp) {
+    BaseNode<T> head;
+    BaseNode<T>* tail = &head;
+    while (first != nullptr && second != nullptr) {
+      if (comp(second->ValueReference(), first->ValueReference())) {
+        tail->next = second;
+        second = second->next;
+      } else {
+        tail->next = first;
+        first = first->next;
       }
-      BaseNode<T>* base = reinterpret_cast<BaseNode<T>*>(ptr);
-      base->next = begin().node->next;
-      base->prev = begin().node;
-      begin().node->next = base;
-      base->next->prev = base;
-      ++size_;
+      tail = tail->next;
     }
+    tail->next = first != nullptr ? first : second;
+    return head.next;
+  }
+
+  static constexpr bool kSplittable = IsSplittable<NodeAllocator>::value;
+
+  static BaseNode<T>* AsBase(Node<T>* node) {
+    return reinterpret_cast<BaseNode<T>*>(node);
   }
 
-  List(const size_t count, const T& value) : size_(count) {
+  // Builds `count` nodes with construct(Node<T>*) as a detached chain and
+  // links it in front of `pos` only once all of them exist, so a throwing
+  // constructor leaves the list unchanged. Returns the first new node.
+  template <typename Construct>
+  BaseNode<T>* InsertBatch(BaseNode<T>* pos, size_t count,
+                           Construct construct) {
+    if (count == 0) {
+      return pos;
+    }
+    Node<T>* block = nullptr;
+    if constexpr (kSplittable) {
+      block = NodeAllocator_traits::allocate(node_alloc, count);
+    }
+    BaseNode<T> chain;
+    size_t built = 0;
     try {
-      for (size_t i = 0; i < count; ++i) {
-        push_back(value);
+      for (; built < count; ++built) {
+        Node<T>* ptr = kSplittable
+                           ? block + built
+                           : NodeAllocator_traits::allocate(node_alloc, 1);
+        try {
+          construct(ptr);
+        } catch (...) {
+          if (!kSplittable) {
+            NodeAllocator_traits::deallocate(node_alloc, ptr, 1);
+          }
+          throw;
+        }
+        LinkBefore(&chain, AsBase(ptr), AsBase(ptr));
       }
     } catch (...) {
-      this->~List();
+      BaseNode<T>* base = chain.next;
+      for (size_t i = 0; i < built; ++i) {
+        BaseNode<T>* next = base->next;
+        Node<T>* ptr = reinterpret_cast<Node<T>*>(base);
+        NodeAllocator_traits::destroy(node_alloc, ptr);
+        if (!kSplittable) {
+          NodeAllocator_traits::deallocate(node_alloc, ptr, 1);
+        }
+        base = next;
+      }
+      if constexpr (kSplittable) {
+        NodeAllocator_traits::deallocate(node_alloc, block, count);
+      }
       throw;
     }
+    BaseNode<T>* first = chain.next;
+    LinkBefore(pos, first, chain.prev);
+    size_ += count;
+    return first;
   }
 
-  List(Alloc alloc) : node_alloc(alloc) {}
+  // Points the neighbours of a sentinel just copied from another list at it.
+  static void Adopt(BaseNode<T>& fake, bool empty) {
+    if (empty) {
+      fake.prev = fake.next = &fake;
+    } else {
+      fake.next->prev = fake.prev->next = &fake;
+    }
+  }
 
-  List(const size_t count, Alloc alloc) : node_alloc(alloc) {
-    for (size_t i = 0; i < count; ++i) {
-      Node<T>* ptr = NodeAllocator_traits::allocate(node_alloc, 1);
-      try {
-        NodeAllocator_traits::construct(node_alloc, ptr);
-      } catch (...) {
+  void SwapNodes(List& other) {
+    std::swap(fakeNode, other.fakeNode);
+    Adopt(fakeNode, other.size_ == 0);
+    Adopt(other.fakeNode, size_ == 0);
+    std::swap(size_, other.size_);
+  }
+
+  // Destroys the nodes of the circular chain around `chain` and, unless
+  // they are still owned by a single block, deallocates them.
+  void DestroyChain(BaseNode<T>& chain, bool deallocate) {
+    BaseNode<T>* base = chain.next;
+    while (base != &chain) {
+      BaseNode<T>* next = base->next;
+      Node<T>* ptr = reinterpret_cast<Node<T>*>(base);
+      NodeAllocator_traits::destroy(node_alloc, ptr);
+      if (deallocate) {
         NodeAllocator_traits::deallocate(node_alloc, ptr, 1);
-        this->~List();
-        throw;
       }
-      BaseNode<T>* base = reinterpret_cast<BaseNode<T>*>(ptr);
-      base->next = begin().node->next;
-      base->prev = begin().node;
-      begin().node->next = base;
-      base->next->prev = base;
-      ++size_;
+      base = next;
     }
   }
 
-  List(const size_t count, const T& value, const Alloc& alloc)
-      : size_(count), node_alloc(alloc) {
-    try {
-      for (size_t i = 0; i < count; ++i) {
-        push_back(value);
-      }
-    } catch (...) {
-      this->~List();
-      throw;
+  // Deallocates unconstructed nodes chained through `next` up to nullptr.
+  void DeallocateRaw(BaseNode<T>* base) {
+    while (base != nullptr) {
+      BaseNode<T>* next = base->next;
+      NodeAllocator_traits::deallocate(node_alloc,
+                                       reinterpret_cast<Node<T>*>(base), 1);
+      base = next;
     }
   }
 
+  // Fallback for unequal allocators: moves [first, last) of `other` into
+  // new nodes in front of `pos` and erases the originals.
+  void TransferByMove(NodeIterator<T, true> pos, List& other,
+                      NodeIterator<T, true> first,
+                      NodeIterator<T, true> last) {
+    while (first != last) {
+      insert(pos, std::move(first.node->ValueReference()));
+      other.erase(first++);
+    }
+  }
+
+ public:
+  using iterator = NodeIterator<T, false>;
+  using const_iterator = NodeIterator<T, true>;
+  using reverse_iterator = std::reverse_iterator<iterator>;
+  using const_reverse_iterator = std::reverse_iterator<const_iterator>;
+  [[no_unique_address]] NodeAllocator node_alloc;
+
+  List() {}
+
+  List(const size_t count) {
+    InsertBatch(&fakeNode, count, [this](Node<T>* ptr) {
+      NodeAllocator_traits::construct(node_alloc, ptr);
+    });
+  }
+
+  List(const size_t count, const T& value) { insert(end(), count, value); }
+
+  List(Alloc alloc) : node_alloc(alloc) {}
+
+  List(const size_t count, Alloc alloc) : node_alloc(alloc) {
+    InsertBatch(&fakeNode, count, [this](Node<T>* ptr) {
+      NodeAllocator_traits::construct(node_alloc, ptr);
+    });
+  }
+
+  List(const size_t count, const T& value, const Alloc& alloc)
+      : node_alloc(alloc) {
+    insert(end(), count, value);
+  }
+
   NodeAllocator get_allocator() { return node_alloc; }
 
   ~List() {
@@ -266,45 +623,144 @@ class List {
     }
   }
   List<T, Alloc>& operator=(const List<T, Alloc>& other) {
+    if (this == &other) {
+      return *this;
+    }
     if constexpr (NodeAllocator_traits::propagate_on_container_copy_assignment::
                       value) {
       List<T, Alloc> copy(other, other.node_alloc);
-      std::swap(size_, copy.size_);
-      std::swap(node_alloc, copy.node_alloc);
-      std::swap(fakeNode, copy.fakeNode);
+      swap(copy);
+    } else {
+      List<T, Alloc> copy(other, node_alloc);
+      swap(copy);
+    }
+    return *this;
+  }
+
+  List(List&& other) : node_alloc(other.node_alloc) {
+    SwapNodes(other);
+  }
+
+  // Without allocator propagation, nodes move over only if the allocators
+  // are equal; otherwise the elements are moved one by one.
+  List<T, Alloc>& operator=(List&& other) {
+    if (this == &other) {
+      return *this;
+    }
+    if constexpr (NodeAllocator_traits::propagate_on_container_move_assignment::
+                      value) {
+      List<T, Alloc> old(std::move(*this));
+      node_alloc = other.node_alloc;
+      SwapNodes(other);
+    } else if (SameAllocator(other)) {
+      List<T, Alloc> old(std::move(*this));
+      SwapNodes(other);
     } else {
-      List<T, Alloc> copy(other);
-      std::swap(size_, copy.size_);
-      std::swap(node_alloc, copy.node_alloc);
-      std::swap(fakeNode, copy.fakeNode);
+      List<T, Alloc> moved(node_alloc);
+      for (T& value : other) {
+        moved.push_back(std::move(value));
+      }
+      swap(moved);
+      other.clear();
     }
     return *this;
   }
 
+  // Exchanges the nodes; allocators are exchanged only when they propagate
+  // on swap, and otherwise must compare equal.
+  void swap(List& other) {
+    SwapNodes(other);
+    if constexpr (NodeAllocator_traits::propagate_on_container_swap::value) {
+      std::swap(node_alloc, other.node_alloc);
+    }
+  }
+
+  void clear() {
+    while (size_ != 0) {
+      pop_front();
+    }
+  }
+
   size_t size() const { return size_; }
 
   void push_back(const T& value) { insert(end(), value); }
+  void push_back(T&& value) { insert(end(), std::move(value)); }
 
   void push_front(const T& value) { insert(begin(), value); }
+  void push_front(T&& value) { insert(begin(), std::move(value)); }
 
   void pop_back() { erase(--end()); }
 
   void pop_front() { erase(begin()); }
 
-  void insert(const_iterator it, const T& value) {
+  // Constructs the element in its node from `args`.
+  template <typename... Args>
+  iterator emplace(const_iterator it, Args&&... args) {
     Node<T>* ptr = NodeAllocator_traits::allocate(node_alloc, 1);
     try {
-      NodeAllocator_traits::construct(node_alloc, ptr, value);
+      NodeAllocator_traits::construct(node_alloc, ptr, std::in_place,
+                                      std::forward<Args>(args)...);
     } catch (...) {
       NodeAllocator_traits::deallocate(node_alloc, ptr, 1);
       throw;
     }
-    BaseNode<T>* base = reinterpret_cast<BaseNode<T>*>(ptr);
-    base->prev = it.node->prev;
-    base->next = it.node;
-    base->prev->next = base;
-    base->next->prev = base;
+    BaseNode<T>* base = AsBase(ptr);
+    LinkBefore(it.node, base, base);
     ++size_;
+    return iterator(base);
+  }
+
+  template <typename... Args>
+  T& emplace_back(Args&&... args) {
+    return *emplace(end(), std::forward<Args>(args)...);
+  }
+
+  template <typename... Args>
+  T& emplace_front(Args&&... args) {
+    return *emplace(begin(), std::forward<Args>(args)...);
+  }
+
+  iterator insert(const_iterator it, const T& value) {
+    return emplace(it, value);
+  }
+  iterator insert(const_iterator it, T&& value) {
+    return emplace(it, std::move(value));
+  }
+
+  // Range insertions put in all the elements or, if one throws, none; with
+  // a splittable allocator their nodes come from a single allocation.
+  // Each returns an iterator to the first inserted element, or `it`.
+  iterator insert(const_iterator it, size_t count, const T& value) {
+    return iterator(InsertBatch(it.node, count, [&](Node<T>* ptr) {
+      NodeAllocator_traits::construct(node_alloc, ptr, std::in_place, value);
+    }));
+  }
+
+  template <std::input_iterator InputIt>
+  iterator insert(const_iterator it, InputIt first, InputIt last) {
+    if constexpr (std::forward_iterator<InputIt>) {
+      return iterator(InsertBatch(
+          it.node, std::distance(first, last), [&](Node<T>* ptr) {
+            NodeAllocator_traits::construct(node_alloc, ptr, std::in_place,
+                                            *first);
+            ++first;
+          }));
+    } else {
+      List<T, Alloc> chain(node_alloc);
+      for (; first != last; ++first) {
+        chain.emplace_back(*first);
+      }
+      if (chain.size_ == 0) {
+        return iterator(it.node);
+      }
+      iterator inserted = chain.begin();
+      splice(it, chain);
+      return inserted;
+    }
+  }
+
+  iterator insert(const_iterator it, std::initializer_list<T> values) {
+    return insert(it, values.begin(), values.end());
   }
 
   void erase(const_iterator it) {
@@ -317,6 +773,251 @@ class List {
     --size_;
   }
 
+  // The splice and merge overloads relink nodes in O(1) each without
+  // allocating when the allocators compare equal. Otherwise they move the
+  // elements into new nodes of this list and erase them from `other`; that
+  // fallback is not even compiled for allocators that are always equal.
+  void splice(const_iterator pos, List& other) {
+    if (&other == this || other.size_ == 0) {
+      return;
+    }
+    if constexpr (!NodeAllocator_traits::is_always_equal::value) {
+      if (!SameAllocator(other)) {
+        TransferByMove(pos, other, other.begin(), other.end());
+        return;
+      }
+    }
+    BaseNode<T>* first = other.fakeNode.next;
+    BaseNode<T>* last = other.fakeNode.prev;
+    Unlink(first, last);
+    LinkBefore(pos.node, first, last);
+    size_ += other.size_;
+    other.size_ = 0;
+  }
+  void splice(const_iterator pos, List&& other) { splice(pos, other); }
+
+  void splice(const_iterator pos, List& other, const_iterator it) {
+    if (pos.node == it.node || pos.node == it.node->next) {
+      return;
+    }
+    if constexpr (!NodeAllocator_traits::is_always_equal::value) {
+      if (!SameAllocator(other)) {
+        TransferByMove(pos, other, it, std::next(it));
+        return;
+      }
+    }
+    Unlink(it.node, it.node);
+    LinkBefore(pos.node, it.node, it.node);
+    ++size_;
+    --other.size_;
+  }
+  void splice(const_iterator pos, List&& other, const_iterator it) {
+    splice(pos, other, it);
+  }
+
+  // Linear in the length of the range when `other` is another list, which
+  // is needed to keep both sizes.
+  void splice(const_iterator pos, List& other, const_iterator first,
+              const_iterator last) {
+    if (first == last) {
+      return;
+    }
+    if constexpr (!NodeAllocator_traits::is_always_equal::value) {
+      if (!SameAllocator(other)) {
+        TransferByMove(pos, other, first, last);
+        return;
+      }
+    }
+    if (&other != this) {
+      size_t count = std::distance(first, last);
+      size_ += count;
+      other.size_ -= count;
+    }
+    BaseNode<T>* tail = last.node->prev;
+    Unlink(first.node, tail);
+    LinkBefore(pos.node, first.node, tail);
+  }
+  void splice(const_iterator pos, List&& other, const_iterator first,
+              const_iterator last) {
+    splice(pos, other, first, last);
+  }
+
+  // Both lists must be sorted by `comp`; the result is too, and equal
+  // elements of this list stay ahead of those from `other`. If `comp`
+  // throws, both lists stay valid and no element is lost.
+  template <typename Compare = std::less<>>
+  void merge(List& other, Compare comp = Compare()) {
+    if (&other == this) {
+      return;
+    }
+    if constexpr (!NodeAllocator_traits::is_always_equal::value) {
+      if (!SameAllocator(other)) {
+        iterator pos = begin();
+        while (other.size_ != 0) {
+          while (pos != end() && !comp(*other.begin(), *pos)) {
+            ++pos;
+          }
+          insert(pos, std::move(*other.begin()));
+          other.pop_front();
+        }
+        return;
+      }
+    }
+    BaseNode<T>* pos = fakeNode.next;
+    BaseNode<T>* node = other.fakeNode.next;
+    while (node != &other.fakeNode) {
+      while (pos != &fakeNode &&
+             !comp(node->ValueReference(), pos->ValueReference())) {
+        pos = pos->next;
+      }
+      // the run of `other` that goes in front of `pos`
+      BaseNode<T>* last = node;
+      size_t count = 1;
+      if (pos == &fakeNode) {
+        last = other.fakeNode.prev;
+        count = other.size_;
+      } else {
+        while (last->next != &other.fakeNode &&
+               comp(last->next->ValueReference(), pos->ValueReference())) {
+          last = last->next;
+          ++count;
+        }
+      }
+      // both sizes stay exact in case a later `comp` throws
+      BaseNode<T>* next = last->next;
+      Unlink(node, last);
+      LinkBefore(pos, node, last);
+      size_ += count;
+      other.size_ -= count;
+      node = next;
+    }
+  }
+  template <typename Compare = std::less<>>
+  void merge(List&& other, Compare comp = Compare()) {
+    merge(other, comp);
+  }
+
+  // Stable bottom-up merge sort over the links: no element is copied and
+  // nothing is allocated. `comp` must not throw.
+  template <typename Compare = std::less<>>
+  void sort(Compare comp = Compare()) {
+    if (size_ < 2) {
+      return;
+    }
+    // bins[i] is a sorted run of 2^i nodes, older runs in higher bins
+    BaseNode<T>* bins[64] = {};
+    fakeNode.prev->next = nullptr;
+    BaseNode<T>* node = fakeNode.next;
+    while (node != nullptr) {
+      BaseNode<T>* run = node;
+      node = node->next;
+      run->next = nullptr;
+      size_t bin = 0;
+      for (; bins[bin] != nullptr; ++bin) {
+        run = MergeRuns(bins[bin], run, comp);
+        bins[bin] = nullptr;
+      }
+      bins[bin] = run;
+    }
+    BaseNode<T>* sorted = nullptr;
+    for (BaseNode<T>* run : bins) {
+      if (run != nullptr) {
+        sorted = sorted == nullptr ? run : MergeRuns(run, sorted, comp);
+      }
+    }
+    BaseNode<T>* prev = &fakeNode;
+    for (node = sorted; node != nullptr; node = node->next) {
+      node->prev = prev;
+      prev->next = node;
+      prev = node;
+    }
+    prev->next = &fakeNode;
+    fakeNode.prev = prev;
+  }
+
+  // Moves every element into freshly allocated nodes laid out in list
+  // order and frees the old ones, so that traversal after long churn walks
+  // memory sequentially again. With a splittable allocator (StackAllocator)
+  // the new nodes are one block; otherwise they are allocated back to back.
+  // All nodes are allocated before any element is touched, and elements are
+  // moved only if that cannot throw and copied otherwise, so a throwing
+  // allocation or copy leaves the list unchanged. All iterators and
+  // references are invalidated; relocate(from, to) is then called for each
+  // element, with `from` still allocated but moved from, so that owners of
+  // stable handles can re-point them. If relocate throws, the list is
+  // already compacted and the remaining calls are skipped.
+  template <typename Relocate>
+  void compact(Relocate relocate) {
+    if (size_ == 0) {
+      return;
+    }
+    size_t count = size_;
+    Node<T>* block = nullptr;
+    if constexpr (kSplittable) {
+      block = NodeAllocator_traits::allocate(node_alloc, count);
+    }
+    // raw nodes, chained through `next` of a bare BaseNode in each
+    BaseNode<T> raw(nullptr, nullptr);
+    BaseNode<T>* tail = &raw;
+    if constexpr (!kSplittable) {
+      try {
+        for (size_t i = 0; i < count; ++i) {
+          Node<T>* ptr = NodeAllocator_traits::allocate(node_alloc, 1);
+          tail = tail->next = new (AsBase(ptr)) BaseNode<T>(nullptr, nullptr);
+        }
+      } catch (...) {
+        DeallocateRaw(raw.next);
+        throw;
+      }
+    }
+    BaseNode<T> fresh;
+    BaseNode<T>* source = fakeNode.next;
+    BaseNode<T>* next_raw = raw.next;
+    Node<T>* pending = nullptr;
+    try {
+      for (size_t i = 0; i < count; ++i, source = source->next) {
+        if constexpr (kSplittable) {
+          pending = block + i;
+        } else {
+          pending = reinterpret_cast<Node<T>*>(next_raw);
+          next_raw = next_raw->next;
+        }
+        NodeAllocator_traits::construct(
+            node_alloc, pending, std::in_place,
+            std::move_if_noexcept(source->ValueReference()));
+        LinkBefore(&fresh, AsBase(pending), AsBase(pending));
+      }
+    } catch (...) {
+      DestroyChain(fresh, !kSplittable);
+      if constexpr (kSplittable) {
+        NodeAllocator_traits::deallocate(node_alloc, block, count);
+      } else {
+        NodeAllocator_traits::deallocate(node_alloc, pending, 1);
+        DeallocateRaw(next_raw);
+      }
+      throw;
+    }
+    BaseNode<T> old;
+    LinkBefore(&old, fakeNode.next, fakeNode.prev);
+    fakeNode.prev = fakeNode.next = &fakeNode;
+    LinkBefore(&fakeNode, fresh.next, fresh.prev);
+    try {
+      BaseNode<T>* to = fakeNode.next;
+      for (BaseNode<T>* from = old.next; from != &old; from = from->next) {
+        relocate(iterator(from), iterator(to));
+        to = to->next;
+      }
+    } catch (...) {
+      DestroyChain(old, true);
+      throw;
+    }
+    DestroyChain(old, true);
+  }
+
+  void compact() {
+    compact([](iterator, iterator) {});
+  }
+
   iterator begin() { return iterator(fakeNode.next); }
   const_iterator begin() const { return const_iterator(fakeNode.next); }
   const_iterator cbegin() const { return const_iterator(fakeNode.next); }
@@ -341,3 +1042,1280 @@ class List {
     return const_reverse_iterator(begin());
   }
 };
+
+template <typename T>
+struct UnrolledBlockBase {
+  UnrolledBlockBase* prev = this;
+  UnrolledBlockBase* next = this;
+  size_t count = 0;
+};
+
+// Up to K elements stored inline; slots [0, count) are constructed.
+template <typename T, size_t K>
+struct UnrolledBlock : UnrolledBlockBase<T> {
+  alignas(T) unsigned char storage[K * sizeof(T)];
+
+  T* Slot(size_t index) {
+    return std::launder(reinterpret_cast<T*>(storage) + index);
+  }
+};
+
+template <typename T, size_t K, bool IsConst>
+struct UnrolledIterator {
+  using Type = typename std::conditional<IsConst, const T, T>::type;
+  using difference_type = int64_t;
+  using iterator_category = std::bidirectional_iterator_tag;
+  using pointer = Type*;
+  using reference = Type&;
+  using value_type = Type;
+
+  UnrolledBlockBase<T>* block;
+  size_t index;
+
+  UnrolledIterator(const UnrolledBlockBase<T>* block, size_t index)
+      : block(const_cast<UnrolledBlockBase<T>*>(block)), index(index) {}
+
+  UnrolledIterator(const UnrolledIterator<T, K, false>& other)
+      : block(other.block), index(other.index) {}
+
+  UnrolledIterator& operator++() {
+    if (++index == block->count) {
+      block = block->next;
+      index = 0;
+    }
+    return *this;
+  }
+
+  UnrolledIterator operator++(int) {
+    auto temp = *this;
+    ++*this;
+    return temp;
+  }
+
+  UnrolledIterator& operator--() {
+    if (index == 0) {
+      block = block->prev;
+      index = block->count;
+    }
+    --index;
+    return *this;
+  }
+
+  UnrolledIterator operator--(int) {
+    auto temp = *this;
+    --*this;
+    return temp;
+  }
+
+  reference operator*() const {
+    return *static_cast<UnrolledBlock<T, K>*>(block)->Slot(index);
+  }
+  pointer operator->() const {
+    return static_cast<UnrolledBlock<T, K>*>(block)->Slot(index);
+  }
+
+  friend bool operator==(const UnrolledIterator& first,
+                         const UnrolledIterator& second) {
+    return first.block == second.block && first.index == second.index;
+  }
+  friend bool operator!=(const UnrolledIterator& first,
+                         const UnrolledIterator& second) {
+    return !(first == second);
+  }
+};
+
+// List that packs up to K elements into each node, so traversal touches one
+// allocation per K elements instead of one per element. Iterators are
+// bidirectional, as for List, but insert and erase move elements within a
+// block: they invalidate iterators and references to the elements of the
+// block at the position and of its successor (which a full block is split
+// into and an underfull one is merged with). Iterators into other blocks
+// stay valid.
+template <typename T, typename Alloc = std::allocator<T>,
+          size_t K = std::max<size_t>(4, 256 / sizeof(T))>
+class UnrolledList {
+ private:
+  using Block = UnrolledBlock<T, K>;
+  using BlockBase = UnrolledBlockBase<T>;
+  using BlockAllocator =
+      typename std::allocator_traits<Alloc>::template rebind_alloc<Block>;
+  using BlockAllocator_traits =
+      typename std::allocator_traits<Alloc>::template rebind_traits<Block>;
+
+  size_t size_ = 0;
+  BlockBase fakeBlock;
+  [[no_unique_address]] BlockAllocator block_alloc;
+
+  static Block* AsBlock(BlockBase* base) { return static_cast<Block*>(base); }
+
+  // Links an empty block after `prev`.
+  Block* NewBlock(BlockBase* prev) {
+    Block* block = BlockAllocator_traits::allocate(block_alloc, 1);
+    BlockAllocator_traits::construct(block_alloc, block);
+    BlockBase* base = block;
+    base->prev = prev;
+    base->next = prev->next;
+    prev->next->prev = base;
+    prev->next = base;
+    return block;
+  }
+
+  void FreeBlock(BlockBase* base) {
+    base->prev->next = base->next;
+    base->next->prev = base->prev;
+    BlockAllocator_traits::destroy(block_alloc, AsBlock(base));
+    BlockAllocator_traits::deallocate(block_alloc, AsBlock(base), 1);
+  }
+
+  // Moves slots [from, count) of `block` to the front of the empty `to`.
+  void MoveTail(Block* block, size_t from, Block* to) {
+    for (size_t i = from; i < block->count; ++i) {
+      BlockAllocator_traits::construct(block_alloc, to->Slot(i - from),
+                                       std::move(*block->Slot(i)));
+      BlockAllocator_traits::destroy(block_alloc, block->Slot(i));
+    }
+    to->count = block->count - from;
+    block->count = from;
+  }
+
+  static void Adopt(BlockBase& fake, bool empty) {
+    if (empty) {
+      fake.prev = fake.next = &fake;
+    } else {
+      fake.next->prev = fake.prev->next = &fake;
+    }
+  }
+
+  void SwapBlocks(UnrolledList& other) {
+    std::swap(fakeBlock, other.fakeBlock);
+    Adopt(fakeBlock, other.size_ == 0);
+    Adopt(other.fakeBlock, size_ == 0);
+    std::swap(size_, other.size_);
+  }
+
+  bool SameAllocator(const UnrolledList& other) const {
+    if constexpr (BlockAllocator_traits::is_always_equal::value) {
+      return true;
+    } else {
+      return block_alloc == other.block_alloc;
+    }
+  }
+
+  template <typename U>
+  UnrolledIterator<T, K, false> Insert(UnrolledIterator<T, K, true> it,
+                                       U&& value) {
+    if (it.block == &fakeBlock) {
+      return Place(it, std::forward<U>(value));
+    }
+    // `value` may live in the block that is about to be shifted or split
+    T element(std::forward<U>(value));
+    return Place(it, std::move(element));
+  }
+
+  // Puts `value` at `it`; appending moves no existing element.
+  template <typename U>
+  UnrolledIterator<T, K, false> Place(UnrolledIterator<T, K, true> it,
+                                      U&& value) {
+    BlockBase* base = it.block;
+    size_t index = it.index;
+    if (base == &fakeBlock) {
+      // appending: fill the last block before adding one
+      base = fakeBlock.prev;
+      index = base->count;
+      if (base == &fakeBlock || base->count == K) {
+        base = NewBlock(fakeBlock.prev);
+        index = 0;
+      }
+    } else if (base->count == K) {
+      Block* half = NewBlock(base);
+      MoveTail(AsBlock(base), K / 2, half);
+      if (index > K / 2) {
+        base = half;
+        index -= K / 2;
+      }
+    }
+    Block* block = AsBlock(base);
+    T* last = block->Slot(block->count);
+    if (index == block->count) {
+      try {
+        BlockAllocator_traits::construct(block_alloc, last,
+                                         std::forward<U>(value));
+      } catch (...) {
+        if (block->count == 0) {
+          FreeBlock(block);
+        }
+        throw;
+      }
+      ++block->count;
+      ++size_;
+    } else {
+      BlockAllocator_traits::construct(block_alloc, last,
+                                       std::move(last[-1]));
+      ++block->count;
+      ++size_;
+      std::move_backward(block->Slot(index), last - 1, last);
+      *block->Slot(index) = std::forward<U>(value);
+    }
+    return UnrolledIterator<T, K, false>(block, index);
+  }
+
+  void Clear() {
+    BlockBase* base = fakeBlock.next;
+    while (base != &fakeBlock) {
+      BlockBase* next = base->next;
+      for (size_t i = 0; i < base->count; ++i) {
+        BlockAllocator_traits::destroy(block_alloc, AsBlock(base)->Slot(i));
+      }
+      BlockAllocator_traits::destroy(block_alloc, AsBlock(base));
+      BlockAllocator_traits::deallocate(block_alloc, AsBlock(base), 1);
+      base = next;
+    }
+    fakeBlock.prev = fakeBlock.next = &fakeBlock;
+    size_ = 0;
+  }
+
+ public:
+  using value_type = T;
+  using iterator = UnrolledIterator<T, K, false>;
+  using const_iterator = UnrolledIterator<T, K, true>;
+  using reverse_iterator = std::reverse_iterator<iterator>;
+  using const_reverse_iterator = std::reverse_iterator<const_iterator>;
+
+  UnrolledList() {}
+
+  UnrolledList(const Alloc& alloc) : block_alloc(alloc) {}
+
+  UnrolledList(size_t count, const T& value, const Alloc& alloc = Alloc())
+      : block_alloc(alloc) {
+    try {
+      for (size_t i = 0; i < count; ++i) {
+        push_back(value);
+      }
+    } catch (...) {
+      Clear();
+      throw;
+    }
+  }
+
+  UnrolledList(const UnrolledList& other)
+      : UnrolledList(
+            other, BlockAllocator_traits::select_on_container_copy_construction(
+                       other.block_alloc)) {}
+
+  UnrolledList(const UnrolledList& other, const Alloc& alloc)
+      : block_alloc(alloc) {
+    try {
+      for (const T& value : other) {
+        push_back(value);
+      }
+    } catch (...) {
+      Clear();
+      throw;
+    }
+  }
+
+  UnrolledList& operator=(const UnrolledList& other) {
+    if (this == &other) {
+      return *this;
+    }
+    if constexpr (BlockAllocator_traits::
+                      propagate_on_container_copy_assignment::value) {
+      UnrolledList copy(other, other.block_alloc);
+      SwapBlocks(copy);
+      std::swap(block_alloc, copy.block_alloc);
+    } else {
+      UnrolledList copy(other, block_alloc);
+      SwapBlocks(copy);
+    }
+    return *this;
+  }
+
+  UnrolledList(UnrolledList&& other) : block_alloc(other.block_alloc) {
+    SwapBlocks(other);
+  }
+
+  // Without allocator propagation, blocks move over only if the allocators
+  // are equal; otherwise the elements are moved one by one.
+  UnrolledList& operator=(UnrolledList&& other) {
+    if (this == &other) {
+      return *this;
+    }
+    if constexpr (BlockAllocator_traits::
+                      propagate_on_container_move_assignment::value) {
+      Clear();
+      block_alloc = other.block_alloc;
+      SwapBlocks(other);
+    } else if (SameAllocator(other)) {
+      Clear();
+      SwapBlocks(other);
+    } else {
+      UnrolledList moved(block_alloc);
+      for (T& value : other) {
+        moved.push_back(std::move(value));
+      }
+      SwapBlocks(moved);
+      other.Clear();
+    }
+    return *this;
+  }
+
+  ~UnrolledList() { Clear(); }
+
+  // Exchanges the blocks; allocators are exchanged only when they propagate
+  // on swap, and otherwise must compare equal.
+  void swap(UnrolledList& other) {
+    SwapBlocks(other);
+    if constexpr (BlockAllocator_traits::propagate_on_container_swap::value) {
+      std::swap(block_alloc, other.block_alloc);
+    }
+  }
+
+  size_t size() const { return size_; }
+  bool empty() const { return size_ == 0; }
+
+  T& front() { return *begin(); }
+  const T& front() const { return *begin(); }
+  T& back() { return *--end(); }
+  const T& back() const { return *--end(); }
+
+  void push_back(const T& value) { insert(end(), value); }
+  void push_back(T&& value) { insert(end(), std::move(value)); }
+  void push_front(const T& value) { insert(begin(), value); }
+  void push_front(T&& value) { insert(begin(), std::move(value)); }
+  void pop_back() { erase(--end()); }
+  void pop_front() { erase(begin()); }
+
+  // Returns an iterator to the inserted element.
+  iterator insert(const_iterator it, const T& value) {
+    return Insert(it, value);
+  }
+  iterator insert(const_iterator it, T&& value) {
+    return Insert(it, std::move(value));
+  }
+
+  // Returns an iterator to the element after the erased one.
+  iterator erase(const_iterator it) {
+    Block* block = AsBlock(it.block);
+    size_t index = it.index;
+    std::move(block->Slot(index + 1), block->Slot(block->count),
+              block->Slot(index));
+    BlockAllocator_traits::destroy(block_alloc, block->Slot(block->count - 1));
+    --block->count;
+    --size_;
+    BlockBase* next = block->next;
+    if (block->count == 0) {
+      FreeBlock(block);
+      return iterator(next, 0);
+    }
+    if (next != &fakeBlock && block->count + next->count <= K / 2) {
+      Block* source = AsBlock(next);
+      for (size_t i = 0; i < source->count; ++i) {
+        BlockAllocator_traits::construct(block_alloc,
+                                         block->Slot(block->count + i),
+                                         std::move(*source->Slot(i)));
+        BlockAllocator_traits::destroy(block_alloc, source->Slot(i));
+      }
+      block->count += source->count;
+      FreeBlock(source);
+    }
+    if (index == block->count) {
+      return iterator(block->next, 0);
+    }
+    return iterator(block, index);
+  }
+
+  void clear() { Clear(); }
+
+  iterator begin() { return iterator(fakeBlock.next, 0); }
+  const_iterator begin() const { return const_iterator(fakeBlock.next, 0); }
+  const_iterator cbegin() const { return const_iterator(fakeBlock.next, 0); }
+
+  iterator end() { return iterator(&fakeBlock, 0); }
+  const_iterator end() const { return const_iterator(&fakeBlock, 0); }
+  const_iterator cend() const { return const_iterator(&fakeBlock, 0); }
+
+  reverse_iterator rbegin() { return reverse_iterator(end()); }
+  const_reverse_iterator rbegin() const {
+    return const_reverse_iterator(end());
+  }
+  reverse_iterator rend() { return reverse_iterator(begin()); }
+  const_reverse_iterator rend() const {
+    return const_reverse_iterator(begin());
+  }
+};
+
+// Link embedded in objects threaded onto an IntrusiveList; an object can sit
+// on as many lists at once as it has hooks. Copying an object does not copy
+// its links, and an object must be unlinked before it is destroyed.
+struct ListHook {
+  ListHook* prev = nullptr;
+  ListHook* next = nullptr;
+
+  ListHook() {}
+  ListHook(const ListHook&) {}
+  ListHook& operator=(const ListHook&) { return *this; }
+
+  bool is_linked() const { return next != nullptr; }
+};
+
+// Maps between an object and the hook at byte `HookOffset` inside it, as
+// given by offsetof(T, hook); offsetof needs a standard-layout T.
+template <typename T, size_t HookOffset>
+struct HookTraits {
+  static ListHook* Hook(const T* object) {
+    return reinterpret_cast<ListHook*>(
+        reinterpret_cast<char*>(const_cast<T*>(object)) + HookOffset);
+  }
+
+  static T* Owner(ListHook* hook) {
+    return reinterpret_cast<T*>(reinterpret_cast<char*>(hook) - HookOffset);
+  }
+};
+
+template <typename T, size_t HookOffset, bool IsConst>
+struct IntrusiveIterator {
+  using Type = typename std::conditional<IsConst, const T, T>::type;
+  using difference_type = int64_t;
+  using iterator_category = std::bidirectional_iterator_tag;
+  using pointer = Type*;
+  using reference = Type&;
+  using value_type = Type;
+
+  ListHook* hook;
+
+  IntrusiveIterator(const ListHook* hook)
+      : hook(const_cast<ListHook*>(hook)) {}
+
+  IntrusiveIterator(const IntrusiveIterator<T, HookOffset, false>& other)
+      : hook(other.hook) {}
+
+  IntrusiveIterator& operator++() {
+    hook = hook->next;
+    return *this;
+  }
+
+  IntrusiveIterator operator++(int) {
+    auto temp = *this;
+    hook = hook->next;
+    return temp;
+  }
+
+  IntrusiveIterator& operator--() {
+    hook = hook->prev;
+    return *this;
+  }
+
+  IntrusiveIterator operator--(int) {
+    auto temp = *this;
+    hook = hook->prev;
+    return temp;
+  }
+
+  reference operator*() const {
+    return *HookTraits<T, HookOffset>::Owner(hook);
+  }
+  pointer operator->() const { return HookTraits<T, HookOffset>::Owner(hook); }
+
+  friend bool operator==(const IntrusiveIterator& first,
+                         const IntrusiveIterator& second) {
+    return first.hook == second.hook;
+  }
+  friend bool operator!=(const IntrusiveIterator& first,
+                         const IntrusiveIterator& second) {
+    return !(first == second);
+  }
+};
+
+// List of objects owned elsewhere, linked through the hook at `HookOffset`,
+// e.g. IntrusiveList<Task, offsetof(Task, by_deadline)>: inserting and
+// erasing only relink pointers and never allocate, copy or destroy an
+// object. A hook can be on one list at a time; clear() and the destructor
+// unlink every object.
+template <typename T, size_t HookOffset>
+class IntrusiveList {
+ private:
+  static_assert(std::is_standard_layout<T>::value,
+                "the hook offset is only defined for standard-layout types");
+  static_assert(HookOffset + sizeof(ListHook) <= sizeof(T),
+                "the hook must lie inside T");
+
+  size_t size_ = 0;
+  ListHook fakeHook;
+
+  static ListHook* HookOf(const T& value) {
+    return HookTraits<T, HookOffset>::Hook(&value);
+  }
+
+  void Reset() {
+    fakeHook.prev = fakeHook.next = &fakeHook;
+    size_ = 0;
+  }
+
+ public:
+  using value_type = T;
+  using iterator = IntrusiveIterator<T, HookOffset, false>;
+  using const_iterator = IntrusiveIterator<T, HookOffset, true>;
+  using reverse_iterator = std::reverse_iterator<iterator>;
+  using const_reverse_iterator = std::reverse_iterator<const_iterator>;
+
+  IntrusiveList() { Reset(); }
+
+  IntrusiveList(const IntrusiveList& other) = delete;
+  IntrusiveList& operator=(const IntrusiveList& other) = delete;
+
+  IntrusiveList(IntrusiveList&& other) {
+    Reset();
+    swap(other);
+  }
+  IntrusiveList& operator=(IntrusiveList&& other) {
+    if (this != &other) {
+      clear();
+      swap(other);
+    }
+    return *this;
+  }
+
+  ~IntrusiveList() { clear(); }
+
+  void swap(IntrusiveList& other) {
+    std::swap(fakeHook.prev, other.fakeHook.prev);
+    std::swap(fakeHook.next, other.fakeHook.next);
+    std::swap(size_, other.size_);
+    for (IntrusiveList* list : {this, &other}) {
+      ListHook& fake = list->fakeHook;
+      if (list->size_ == 0) {
+        fake.prev = fake.next = &fake;
+      } else {
+        fake.next->prev = fake.prev->next = &fake;
+      }
+    }
+  }
+
+  size_t size() const { return size_; }
+  bool empty() const { return size_ == 0; }
+
+  T& front() { return *begin(); }
+  const T& front() const { return *begin(); }
+  T& back() { return *--end(); }
+  const T& back() const { return *--end(); }
+
+  void push_back(T& value) { insert(end(), value); }
+  void push_front(T& value) { insert(begin(), value); }
+  void pop_back() { erase(--end()); }
+  void pop_front() { erase(begin()); }
+
+  // `value`'s hook must not be linked.
+  iterator insert(const_iterator it, T& value) {
+    ListHook* hook = HookOf(value);
+    hook->prev = it.hook->prev;
+    hook->next = it.hook;
+    hook->prev->next = hook;
+    hook->next->prev = hook;
+    ++size_;
+    return iterator(hook);
+  }
+
+  // Unlinks the object; returns the position after it.
+  iterator erase(const_iterator it) {
+    ListHook* hook = it.hook;
+    ListHook* next = hook->next;
+    hook->prev->next = next;
+    next->prev = hook->prev;
+    hook->prev = hook->next = nullptr;
+    --size_;
+    return iterator(next);
+  }
+
+  // Unlinks `value`, which must be on this list, in O(1).
+  void remove(T& value) { erase(iterator_to(value)); }
+
+  iterator iterator_to(T& value) { return iterator(HookOf(value)); }
+  const_iterator iterator_to(const T& value) const {
+    return const_iterator(HookOf(value));
+  }
+
+  void clear() {
+    ListHook* hook = fakeHook.next;
+    while (hook != &fakeHook) {
+      ListHook* next = hook->next;
+      hook->prev = hook->next = nullptr;
+      hook = next;
+    }
+    Reset();
+  }
+
+  iterator begin() { return iterator(fakeHook.next); }
+  const_iterator begin() const { return const_iterator(fakeHook.next); }
+  const_iterator cbegin() const { return const_iterator(fakeHook.next); }
+
+  iterator end() { return iterator(&fakeHook); }
+  const_iterator end() const { return const_iterator(&fakeHook); }
+  const_iterator cend() const { return const_iterator(&fakeHook); }
+
+  reverse_iterator rbegin() { return reverse_iterator(end()); }
+  const_reverse_iterator rbegin() const {
+    return const_reverse_iterator(end());
+  }
+  const_reverse_iterator crbegin() const {
+    return const_reverse_iterator(end());
+  }
+
+  reverse_iterator rend() { return reverse_iterator(begin()); }
+  const_reverse_iterator rend() const {
+    return const_reverse_iterator(begin());
+  }
+  const_reverse_iterator crend() const {
+    return const_reverse_iterator(begin());
+  }
+};
+
+// Multi-producer/single-consumer queue after Vyukov: producers publish a
+// node with one exchange on head_ and then link it behind its predecessor,
+// the consumer follows `next` links from tail_. Nodes are the Node<T> that
+// List uses, with BaseNode::next accessed through std::atomic_ref; prev is
+// unused. push/emplace may run on any number of threads at once (so the
+// node allocator must be thread-safe), try_pop/try_pop_batch on one thread.
+// Popped nodes are recycled through CacheSize slots that the consumer fills
+// and producers empty with an exchange, so neither side ever takes a lock
+// and the cache cannot suffer from ABA; nodes beyond it go back to Alloc.
+template <typename T, typename Alloc = std::allocator<T>,
+          size_t CacheSize = 64>
+class MpscQueue {
+ private:
+  using NodeAllocator =
+      typename std::allocator_traits<Alloc>::template rebind_alloc<Node<T>>;
+  using NodeAllocator_traits =
+      typename std::allocator_traits<Alloc>::template rebind_traits<Node<T>>;
+  using Link = std::atomic_ref<BaseNode<T>*>;
+
+  static constexpr size_t kLineSize = 64;
+
+  [[no_unique_address]] NodeAllocator node_alloc;
+  BaseNode<T> stub_;
+  alignas(kLineSize) std::atomic<BaseNode<T>*> head_;
+  alignas(kLineSize) BaseNode<T>* tail_;
+  size_t consumer_slot_ = 0;
+  alignas(kLineSize) std::atomic<size_t> cached_{0};
+  std::atomic<size_t> producer_slot_{0};
+  std::atomic<Node<T>*> cache_[CacheSize] = {};
+
+  static BaseNode<T>* AsBase(Node<T>* node) {
+    return reinterpret_cast<BaseNode<T>*>(node);
+  }
+
+  Node<T>* Acquire() {
+    if (cached_.load(std::memory_order_relaxed) != 0) {
+      size_t slot = producer_slot_.fetch_add(1, std::memory_order_relaxed);
+      for (size_t i = 0; i < CacheSize; ++i) {
+        std::atomic<Node<T>*>& entry = cache_[(slot + i) % CacheSize];
+        if (entry.load(std::memory_order_relaxed) == nullptr) {
+          continue;
+        }
+        Node<T>* node = entry.exchange(nullptr, std::memory_order_acquire);
+        if (node != nullptr) {
+          cached_.fetch_sub(1, std::memory_order_relaxed);
+          return node;
+        }
+      }
+    }
+    return NodeAllocator_traits::allocate(node_alloc, 1);
+  }
+
+  // Only the consumer fills slots and producers only empty them, so a slot
+  // seen empty here stays empty until the store below.
+  void Recycle(Node<T>* node) {
+    if (cached_.load(std::memory_order_relaxed) < CacheSize) {
+      for (size_t i = 0; i < CacheSize; ++i) {
+        std::atomic<Node<T>*>& entry = cache_[consumer_slot_];
+        consumer_slot_ = (consumer_slot_ + 1) % CacheSize;
+        if (entry.load(std::memory_order_relaxed) == nullptr) {
+          entry.store(node, std::memory_order_release);
+          cached_.fetch_add(1, std::memory_order_relaxed);
+          return;
+        }
+      }
+    }
+    NodeAllocator_traits::deallocate(node_alloc, node, 1);
+  }
+
+  void Publish(BaseNode<T>* node) {
+    Link(node->next).store(nullptr, std::memory_order_relaxed);
+    BaseNode<T>* prev = head_.exchange(node, std::memory_order_acq_rel);
+    Link(prev->next).store(node, std::memory_order_release);
+  }
+
+  // Detaches the oldest node, or returns nullptr when the queue is empty or
+  // the oldest producer has exchanged head_ but not linked its node yet.
+  BaseNode<T>* Pop() {
+    BaseNode<T>* tail = tail_;
+    BaseNode<T>* next = Link(tail->next).load(std::memory_order_acquire);
+    if (tail == &stub_) {
+      if (next == nullptr) {
+        return nullptr;
+      }
+      tail_ = tail = next;
+      next = Link(tail->next).load(std::memory_order_acquire);
+    }
+    if (next != nullptr) {
+      tail_ = next;
+      return tail;
+    }
+    if (tail != head_.load(std::memory_order_acquire)) {
+      return nullptr;
+    }
+    Publish(&stub_);
+    next = Link(tail->next).load(std::memory_order_acquire);
+    if (next != nullptr) {
+      tail_ = next;
+      return tail;
+    }
+    return nullptr;
+  }
+
+  void Consume(BaseNode<T>* base, T& out) {
+    Node<T>* node = reinterpret_cast<Node<T>*>(base);
+    out = std::move(node->value);
+    NodeAllocator_traits::destroy(node_alloc, node);
+    Recycle(node);
+  }
+
+ public:
+  MpscQueue() : stub_(nullptr, nullptr), head_(&stub_), tail_(&stub_) {}
+
+  MpscQueue(Alloc alloc)
+      : node_alloc(alloc),
+        stub_(nullptr, nullptr),
+        head_(&stub_),
+        tail_(&stub_) {}
+
+  MpscQueue(const MpscQueue& other) = delete;
+  MpscQueue& operator=(const MpscQueue& other) = delete;
+
+  // No producer may still be running.
+  ~MpscQueue() {
+    while (BaseNode<T>* base = Pop()) {
+      Node<T>* node = reinterpret_cast<Node<T>*>(base);
+      NodeAllocator_traits::destroy(node_alloc, node);
+      NodeAllocator_traits::deallocate(node_alloc, node, 1);
+    }
+    for (std::atomic<Node<T>*>& entry : cache_) {
+      if (Node<T>* node = entry.load(std::memory_order_relaxed)) {
+        NodeAllocator_traits::deallocate(node_alloc, node, 1);
+      }
+    }
+  }
+
+  template <typename... Args>
+  void emplace(Args&&... args) {
+    Node<T>* node = Acquire();
+    try {
+      NodeAllocator_traits::construct(node_alloc, node, std::in_place,
+                                      std::forward<Args>(args)...);
+    } catch (...) {
+      NodeAllocator_traits::deallocate(node_alloc, node, 1);
+      throw;
+    }
+    Publish(AsBase(node));
+  }
+
+  void push(const T& value) { emplace(value); }
+  void push(T&& value) { emplace(std::move(value)); }
+
+  // Consumer only.
+  bool try_pop(T& out) {
+    BaseNode<T>* base = Pop();
+    if (base == nullptr) {
+      return false;
+    }
+    Consume(base, out);
+    return true;
+  }
+
+  // Consumer only: moves up to `max` items to `out` and returns how many.
+  template <typename OutputIt>
+  size_t try_pop_batch(OutputIt out, size_t max) {
+    size_t count = 0;
+    for (; count < max; ++count) {
+      BaseNode<T>* base = Pop();
+      if (base == nullptr) {
+        break;
+      }
+      Node<T>* node = reinterpret_cast<Node<T>*>(base);
+      *out = std::move(node->value);
+      ++out;
+      NodeAllocator_traits::destroy(node_alloc, node);
+      Recycle(node);
+    }
+    return count;
+  }
+
+  // Consumer only; a push that is still in progress may not show up yet.
+  bool empty() const {
+    BaseNode<T>*& next = const_cast<BaseNode<T>*&>(stub_.next);
+    return tail_ == &stub_ &&
+           Link(next).load(std::memory_order_acquire) == nullptr;
+  }
+};
+
+struct IndexLinks {
+  uint32_t prev;
+  uint32_t next;
+};
+
+template <typename T>
+struct IndexSlot {
+  IndexLinks links;
+  union {
+    T value;
+  };
+
+  IndexSlot() {}
+  ~IndexSlot() {}
+};
+
+template <typename T, typename Alloc>
+class IndexList;
+
+// Position in an IndexList: the list and a slot index, so that iterators
+// stay valid when the slot array is reallocated.
+template <typename T, typename Alloc, bool IsConst>
+struct IndexIterator {
+  using Type = typename std::conditional<IsConst, const T, T>::type;
+  using difference_type = int64_t;
+  using iterator_category = std::bidirectional_iterator_tag;
+  using pointer = Type*;
+  using reference = Type&;
+  using value_type = Type;
+
+  IndexList<T, Alloc>* list;
+  uint32_t index;
+
+  IndexIterator(const IndexList<T, Alloc>* list, uint32_t index)
+      : list(const_cast<IndexList<T, Alloc>*>(list)), index(index) {}
+
+  IndexIterator(const IndexIterator<T, Alloc, false>& other)
+      : list(other.list), index(other.index) {}
+
+  IndexIterator& operator++() {
+    index = list->Links(index).next;
+    return *this;
+  }
+
+  IndexIterator operator++(int) {
+    auto temp = *this;
+    ++*this;
+    return temp;
+  }
+
+  IndexIterator& operator--() {
+    index = list->Links(index).prev;
+    return *this;
+  }
+
+  IndexIterator operator--(int) {
+    auto temp = *this;
+    --*this;
+    return temp;
+  }
+
+  reference operator*() const { return list->Slot(index).value; }
+  pointer operator->() const { return &list->Slot(index).value; }
+
+  friend bool operator==(const IndexIterator& first,
+                         const IndexIterator& second) {
+    return first.index == second.index;
+  }
+  friend bool operator!=(const IndexIterator& first,
+                         const IndexIterator& second) {
+    return !(first == second);
+  }
+};
+
+// List whose nodes live in one growable slot array and are linked by 32-bit
+// indices: a node costs sizeof(T) plus 8 bytes instead of two pointers plus
+// a heap allocation, and the nodes of a list share pages. Erased slots go on
+// a free-index stack threaded through their `next` links and are reused
+// before the array grows. Index 0 is the sentinel, whose links are kept in
+// the list itself so that an empty list allocates nothing. Growing the
+// array moves the elements: it invalidates references and pointers, but
+// not iterators.
+template <typename T, typename Alloc = std::allocator<T>>
+class IndexList {
+ private:
+  template <typename, typename, bool>
+  friend struct IndexIterator;
+
+  using SlotAllocator =
+      typename std::allocator_traits<Alloc>::template rebind_alloc<
+          IndexSlot<T>>;
+  using SlotAllocator_traits =
+      typename std::allocator_traits<Alloc>::template rebind_traits<
+          IndexSlot<T>>;
+
+  static constexpr uint32_t kEnd = 0;
+  static constexpr uint32_t kMaxCapacity = UINT32_MAX - 1;
+
+  IndexSlot<T>* slots_ = nullptr;  // slot i is slots_[i - 1]
+  uint32_t capacity_ = 0;
+  uint32_t used_ = 0;              // slots 1..used_ have been handed out
+  uint32_t free_ = kEnd;           // top of the free-index stack
+  size_t size_ = 0;
+  IndexLinks fakeLinks = {kEnd, kEnd};
+
+  IndexSlot<T>& Slot(uint32_t index) const { return slots_[index - 1]; }
+
+  IndexLinks& Links(uint32_t index) {
+    return index == kEnd ? fakeLinks : Slot(index).links;
+  }
+
+  bool SameAllocator(const IndexList& other) const {
+    if constexpr (SlotAllocator_traits::is_always_equal::value) {
+      return true;
+    } else {
+      return slot_alloc == other.slot_alloc;
+    }
+  }
+
+  // Moves the elements to `slots`, an array of `capacity` slots, at the
+  // same indices and frees the old array. If a move throws, the list and
+  // `slots` are left as they were.
+  void MoveTo(IndexSlot<T>* slots, uint32_t capacity) {
+    uint32_t index = fakeLinks.next;
+    try {
+      for (; index != kEnd; index = Slot(index).links.next) {
+        SlotAllocator_traits::construct(
+            slot_alloc, &slots[index - 1].value,
+            std::move_if_noexcept(Slot(index).value));
+      }
+    } catch (...) {
+      for (uint32_t i = fakeLinks.next; i != index; i = Slot(i).links.next) {
+        SlotAllocator_traits::destroy(slot_alloc, &slots[i - 1].value);
+      }
+      throw;
+    }
+    for (uint32_t i = 0; i < used_; ++i) {
+      slots[i].links = slots_[i].links;
+    }
+    DestroyValues();
+    if (slots_ != nullptr) {
+      SlotAllocator_traits::deallocate(slot_alloc, slots_, capacity_);
+    }
+    slots_ = slots;
+    capacity_ = capacity;
+  }
+
+  void Reallocate(uint32_t capacity) {
+    IndexSlot<T>* slots = SlotAllocator_traits::allocate(slot_alloc, capacity);
+    try {
+      MoveTo(slots, capacity);
+    } catch (...) {
+      SlotAllocator_traits::deallocate(slot_alloc, slots, capacity);
+      throw;
+    }
+  }
+
+  void DestroyValues() {
+    for (uint32_t i = fakeLinks.next; i != kEnd; i = Slot(i).links.next) {
+      SlotAllocator_traits::destroy(slot_alloc, &Slot(i).value);
+    }
+  }
+
+  bool Full() const { return free_ == kEnd && used_ == capacity_; }
+
+  uint32_t GrownCapacity() const {
+    if (capacity_ == kMaxCapacity) {
+      throw std::length_error("IndexList is full");
+    }
+    return capacity_ > kMaxCapacity / 2 ? kMaxCapacity
+                                        : std::max<uint32_t>(4, 2 * capacity_);
+  }
+
+  // The list must not be Full().
+  uint32_t AcquireSlot() {
+    if (free_ != kEnd) {
+      uint32_t index = free_;
+      free_ = Slot(index).links.next;
+      return index;
+    }
+    return ++used_;
+  }
+
+  // Like std::vector, builds the element in the new array before the old
+  // one is freed, since `args` may refer to an element of this list.
+  template <typename... Args>
+  uint32_t GrowAndConstruct(Args&&... args) {
+    uint32_t capacity = GrownCapacity();
+    IndexSlot<T>* slots = SlotAllocator_traits::allocate(slot_alloc, capacity);
+    uint32_t index = used_ + 1;
+    try {
+      SlotAllocator_traits::construct(slot_alloc, &slots[index - 1].value,
+                                      std::forward<Args>(args)...);
+      try {
+        MoveTo(slots, capacity);
+      } catch (...) {
+        SlotAllocator_traits::destroy(slot_alloc, &slots[index - 1].value);
+        throw;
+      }
+    } catch (...) {
+      SlotAllocator_traits::deallocate(slot_alloc, slots, capacity);
+      throw;
+    }
+    used_ = index;
+    return index;
+  }
+
+  void ReleaseSlot(uint32_t index) {
+    Slot(index).links.next = free_;
+    free_ = index;
+  }
+
+  void StealStorage(IndexList& other) {
+    std::swap(slots_, other.slots_);
+    std::swap(capacity_, other.capacity_);
+    std::swap(used_, other.used_);
+    std::swap(free_, other.free_);
+    std::swap(size_, other.size_);
+    std::swap(fakeLinks, other.fakeLinks);
+  }
+
+  void Release() {
+    DestroyValues();
+    if (slots_ != nullptr) {
+      SlotAllocator_traits::deallocate(slot_alloc, slots_, capacity_);
+    }
+    slots_ = nullptr;
+    capacity_ = used_ = 0;
+    free_ = kEnd;
+    size_ = 0;
+    fakeLinks = {kEnd, kEnd};
+  }
+
+ public:
+  using value_type = T;
+  using iterator = IndexIterator<T, Alloc, false>;
+  using const_iterator = IndexIterator<T, Alloc, true>;
+  using reverse_iterator = std::reverse_iterator<iterator>;
+  using const_reverse_iterator = std::reverse_iterator<const_iterator>;
+  [[no_unique_address]] SlotAllocator slot_alloc;
+
+  IndexList() {}
+
+  IndexList(Alloc alloc) : slot_alloc(alloc) {}
+
+  IndexList(const size_t count, const T& value, Alloc alloc = Alloc())
+      : slot_alloc(alloc) {
+    try {
+      reserve(count);
+      for (size_t i = 0; i < count; ++i) {
+        push_back(value);
+      }
+    } catch (...) {
+      Release();
+      throw;
+    }
+  }
+
+  IndexList(std::initializer_list<T> values, Alloc alloc = Alloc())
+      : slot_alloc(alloc) {
+    try {
+      reserve(values.size());
+      for (const T& value : values) {
+        push_back(value);
+      }
+    } catch (...) {
+      Release();
+      throw;
+    }
+  }
+
+  // Copies are compact: their elements occupy slots 1..size() in order.
+  IndexList(const IndexList& other)
+      : IndexList(other,
+                  SlotAllocator_traits::select_on_container_copy_construction(
+                      other.slot_alloc)) {}
+
+  IndexList(const IndexList& other, Alloc alloc) : slot_alloc(alloc) {
+    try {
+      reserve(other.size_);
+      for (const T& value : other) {
+        push_back(value);
+      }
+    } catch (...) {
+      Release();
+      throw;
+    }
+  }
+
+  IndexList& operator=(const IndexList& other) {
+    if (this == &other) {
+      return *this;
+    }
+    if constexpr (SlotAllocator_traits::
+                      propagate_on_container_copy_assignment::value) {
+      IndexList copy(other, other.slot_alloc);
+      Release();
+      slot_alloc = copy.slot_alloc;
+      StealStorage(copy);
+    } else {
+      IndexList copy(other, slot_alloc);
+      Release();
+      StealStorage(copy);
+    }
+    return *this;
+  }
+
+  IndexList(IndexList&& other) : slot_alloc(other.slot_alloc) {
+    StealStorage(other);
+  }
+
+  // Without allocator propagation, the slot array moves over only if the
+  // allocators are equal; otherwise the elements are moved one by one.
+  IndexList& operator=(IndexList&& other) {
+    if (this == &other) {
+      return *this;
+    }
+    Release();
+    if constexpr (SlotAllocator_traits::
+                      propagate_on_container_move_assignment::value) {
+      slot_alloc = other.slot_alloc;
+      StealStorage(other);
+    } else if (SameAllocator(other)) {
+      StealStorage(other);
+    } else {
+      reserve(other.size_);
+      for (T& value : other) {
+        push_back(std::move(value));
+      }
+      other.clear();
+    }
+    return *this;
+  }
+
+  ~IndexList() { Release(); }
+
+  // Exchanges the slot arrays; allocators are exchanged only when they
+  // propagate on swap, and otherwise must compare equal.
+  void swap(IndexList& other) {
+    StealStorage(other);
+    if constexpr (SlotAllocator_traits::propagate_on_container_swap::value) {
+      std::swap(slot_alloc, other.slot_alloc);
+    }
+  }
+
+  // Makes room for `count` elements without further reallocation.
+  void reserve(size_t count) {
+    if (count > kMaxCapacity) {
+      throw std::length_error("IndexList is full");
+    }
+    // slots on the free stack are reused, so `count` slots in all suffice
+    size_t needed = std::max<size_t>(used_, count);
+    if (needed > capacity_) {
+      Reallocate(static_cast<uint32_t>(needed));
+    }
+  }
+
+  size_t size() const { return size_; }
+  bool empty() const { return size_ == 0; }
+  size_t capacity() const { return capacity_; }
+
+  T& front() { return *begin(); }
+  const T& front() const { return *begin(); }
+  T& back() { return *--end(); }
+  const T& back() const { return *--end(); }
+
+  template <typename... Args>
+  iterator emplace(const_iterator it, Args&&... args) {
+    uint32_t index;
+    if (Full()) {
+      index = GrowAndConstruct(std::forward<Args>(args)...);
+    } else {
+      index = AcquireSlot();
+      try {
+        SlotAllocator_traits::construct(slot_alloc, &Slot(index).value,
+                                        std::forward<Args>(args)...);
+      } catch (...) {
+        ReleaseSlot(index);
+        throw;
+      }
+    }
+    IndexLinks& links = Slot(index).links;
+    links.next = it.index;
+    links.prev = Links(it.index).prev;
+    Links(links.prev).next = index;
+    Links(it.index).prev = index;
+    ++size_;
+    return iterator(this, index);
+  }
+
+  template <typename... Args>
+  T& emplace_back(Args&&... args) {
+    return *emplace(end(), std::forward<Args>(args)...);
+  }
+
+  template <typename... Args>
+  T& emplace_front(Args&&... args) {
+    return *emplace(begin(), std::forward<Args>(args)...);
+  }
+
+  iterator insert(const_iterator it, const T& value) {
+    return emplace(it, value);
+  }
+  iterator insert(const_iterator it, T&& value) {
+    return emplace(it, std::move(value));
+  }
+
+  void push_back(const T& value) { emplace(end(), value); }
+  void push_back(T&& value) { emplace(end(), std::move(value)); }
+  void push_front(const T& value) { emplace(begin(), value); }
+  void push_front(T&& value) { emplace(begin(), std::move(value)); }
+
+  void pop_back() { erase(--end()); }
+  void pop_front() { erase(begin()); }
+
+  // Returns an iterator to the element after the erased one.
+  iterator erase(const_iterator it) {
+    uint32_t index = it.index;
+    IndexLinks links = Slot(index).links;
+    Links(links.prev).next = links.next;
+    Links(links.next).prev = links.prev;
+    SlotAllocator_traits::destroy(slot_alloc, &Slot(index).value);
+    ReleaseSlot(index);
+    --size_;
+    return iterator(this, links.next);
+  }
+
+  // Destroys the elements but keeps the slot array for reuse.
+  void clear() {
+    DestroyValues();
+    used_ = 0;
+    free_ = kEnd;
+    size_ = 0;
+    fakeLinks = {kEnd, kEnd};
+  }
+
+  iterator begin() { return iterator(this, fakeLinks.next); }
+  const_iterator begin() const { return const_iterator(this, fakeLinks.next); }
+  const_iterator cbegin() const {
+    return const_iterator(this, fakeLinks.next);
+  }
+
+  iterator end() { return iterator(this, kEnd); }
+  const_iterator end() const { return const_iterator(this, kEnd); }
+  const_iterator cend() const { return const_iterator(this, kEnd); }
+
+  reverse_iterator rbegin() { return reverse_iterator(end()); }
+  const_reverse_iterator rbegin() const {
+    return const_reverse_iterator(end());
+  }
+  const_reverse_iterator crbegin() const {
+    return const_reverse_iterator(end());
+  }
+
+  reverse_iterator rend() { return reverse_iterator(begin()); }
+  const_reverse_iterator rend() const {
+    return const_reverse_iterator(begin());
+  }
+  const_reverse_iterator crend() const {
+    return const_reverse_iterator(begin());
+  }
+};
@@ -1,224 +1,2920 @@
 #include <algorithm>
+#include <atomic>
+#include <bit>
+#include <charconv>
+#include <concepts>
+#include <cstdint>
 #include <cstring>
+#include <deque>
+#include <functional>
+#include <initializer_list>
 #include <iostream>
+#include <iterator>
+#include <memory>
+#include <mutex>
+#include <shared_mutex>
+#include <system_error>
+#include <thread>
+#include <type_traits>
+#include <utility>
+#include <vector>
 
-class String {
- private:
-  size_t size_ = 0;
-  size_t capacity_ = 0;
-  char* elements = nullptr;
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#include <immintrin.h>
+#define STRING_X86_SIMD
+#endif
 
- public:
-  String(){};
+#if defined(__unix__) || defined(__APPLE__)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#define STRING_MMAP
+#if defined(__linux__)
+#define STRING_MREMAP
+#endif
+#endif
 
-  String(char symb) : size_(1), capacity_(1), elements(new char[2]) {
-    memset(elements, symb, 1);
-    elements[1] = '\0';
+struct ForwardReader {
+  const char* data;
+  char operator[](size_t index) const { return data[index]; }
+};
+
+struct ReverseReader {
+  const char* end;
+  char operator[](size_t index) const { return end[-1 - index]; }
+};
+
+// Crochemore-Perrin Two-Way matching: linear time and constant space, used
+// when candidate filtering degenerates on periodic text and patterns.
+template <typename Reader>
+void MaximalSuffix(Reader pattern, int64_t length, bool reversed,
+                   int64_t& suffix, int64_t& period) {
+  int64_t j = 0;
+  int64_t k = 1;
+  suffix = -1;
+  period = 1;
+  while (j + k < length) {
+    char a = pattern[j + k];
+    char b = pattern[suffix + k];
+    if (reversed ? a > b : a < b) {
+      j += k;
+      k = 1;
+      period = j - suffix;
+    } else if (a == b) {
+      if (k != period) {
+        ++k;
+      } else {
+        j += period;
+        k = 1;
+      }
+    } else {
+      suffix = j;
+      j = suffix + 1;
+      k = period = 1;
+    }
   }
+}
 
-  String(size_t n, char symb)
-      : size_(n), capacity_(n), elements(new char[n + 1]) {
-    std::memset(elements, symb, n);
-    elements[n] = '\0';
+template <typename Reader>
+size_t TwoWaySearch(Reader text, size_t text_size, Reader pattern,
+                    size_t pattern_size, size_t from) {
+  int64_t n = text_size;
+  int64_t m = pattern_size;
+  int64_t first_suffix, first_period, second_suffix, second_period;
+  MaximalSuffix(pattern, m, false, first_suffix, first_period);
+  MaximalSuffix(pattern, m, true, second_suffix, second_period);
+  int64_t ell = first_suffix > second_suffix ? first_suffix : second_suffix;
+  int64_t period =
+      first_suffix > second_suffix ? first_period : second_period;
+  bool periodic = ell + 1 + period <= m;
+  for (int64_t i = 0; periodic && i <= ell; ++i) {
+    periodic = pattern[i] == pattern[i + period];
+  }
+  int64_t j = from;
+  if (periodic) {
+    int64_t memory = -1;
+    while (j <= n - m) {
+      int64_t i = std::max(ell, memory) + 1;
+      while (i < m && pattern[i] == text[i + j]) {
+        ++i;
+      }
+      if (i >= m) {
+        i = ell;
+        while (i > memory && pattern[i] == text[i + j]) {
+          --i;
+        }
+        if (i <= memory) {
+          return j;
+        }
+        j += period;
+        memory = m - period - 1;
+      } else {
+        j += i - ell;
+        memory = -1;
+      }
+    }
+  } else {
+    period = std::max(ell + 1, m - ell - 1) + 1;
+    while (j <= n - m) {
+      int64_t i = ell + 1;
+      while (i < m && pattern[i] == text[i + j]) {
+        ++i;
+      }
+      if (i >= m) {
+        i = ell;
+        while (i >= 0 && pattern[i] == text[i + j]) {
+          --i;
+        }
+        if (i < 0) {
+          return j;
+        }
+        j += period;
+      } else {
+        j += i - ell;
+      }
+    }
   }
+  return text_size;
+}
 
-  String(const String& str) {
-    size_ = str.size_;
-    capacity_ = str.size_;
-    elements = new char[size_ + 1];
-    std::copy(str.elements, str.elements + str.size_, elements);
-    elements[size_] = '\0';
+// Candidate verification gets this many bytes of slack, plus a multiple of
+// the bytes scanned so far, before a search falls back to Two-Way.
+static constexpr size_t kSearchSlack = 4096;
+static constexpr size_t kSearchWorkFactor = 8;
+
+bool SearchBudgetExceeded(size_t misses, size_t pattern_size, size_t scanned) {
+  return misses * pattern_size > kSearchWorkFactor * scanned + kSearchSlack;
+}
+
+size_t FindTail(const char* text, size_t n, const char* pattern, size_t m,
+                size_t from) {
+  for (size_t i = from; i + m <= n; ++i) {
+    if (text[i] == pattern[0] && text[i + m - 1] == pattern[m - 1] &&
+        std::memcmp(text + i, pattern, m) == 0) {
+      return i;
+    }
   }
+  return n;
+}
 
-  String(const char* str) {
-    size_t length = strlen(str);
-    elements = new char[length + 1];
-    std::copy(str + 0, str + length, elements);
-    size_ = length;
-    capacity_ = length;
-    elements[size_] = '\0';
+// Scans candidate starts `to` - 1 down to 0.
+size_t RfindTail(const char* text, size_t n, const char* pattern, size_t m,
+                 size_t to) {
+  for (size_t i = to; i-- > 0;) {
+    if (text[i] == pattern[0] && text[i + m - 1] == pattern[m - 1] &&
+        std::memcmp(text + i, pattern, m) == 0) {
+      return i;
+    }
   }
+  return n;
+}
 
-  String(char* el, size_t sz)
-      : size_(sz), capacity_(sz), elements(new char[sz + 1]) {
-    std::copy(el, el + sz, elements);
-    elements[size_] = '\0';
+size_t FindScalar(const char* text, size_t n, const char* pattern, size_t m) {
+  size_t misses = 0;
+  size_t i = 0;
+  while (i + m <= n) {
+    const void* hit = std::memchr(text + i, pattern[0], n - m + 1 - i);
+    if (hit == nullptr) {
+      return n;
+    }
+    i = static_cast<const char*>(hit) - text;
+    if (std::memcmp(text + i, pattern, m) == 0) {
+      return i;
+    }
+    if (SearchBudgetExceeded(++misses, m, i)) {
+      return TwoWaySearch(ForwardReader{text}, n, ForwardReader{pattern}, m,
+                          i);
+    }
+    ++i;
   }
-  String& operator=(const String& other) {
-    String tmp(other);
-    std::swap(elements, tmp.elements);
-    std::swap(capacity_, tmp.capacity_);
-    std::swap(size_, tmp.size_);
-    return *this;
+  return n;
+}
+
+size_t RfindScalar(const char* text, size_t n, const char* pattern,
+                   size_t m) {
+  size_t misses = 0;
+  for (size_t i = n - m + 1; i-- > 0;) {
+    if (text[i] == pattern[0] && std::memcmp(text + i, pattern, m) == 0) {
+      return i;
+    }
+    if (text[i] == pattern[0] &&
+        SearchBudgetExceeded(++misses, m, n - m + 1 - i)) {
+      size_t found = TwoWaySearch(ReverseReader{text + n}, n,
+                                  ReverseReader{pattern + m}, m, n - m - i + 1);
+      return found == n ? n : n - m - found;
+    }
   }
+  return n;
+}
 
-  size_t length() const { return size_; }
-  size_t capacity() const { return capacity_; }
-  size_t size() const { return size_; }
-  char* str() { return elements; }
-  char& operator[](size_t index) { return elements[index]; }
-  const char& operator[](size_t index) const { return elements[index]; }
+#ifdef STRING_X86_SIMD
+// First-and-last byte filtering: a start is a candidate only if both the
+// first and the last pattern byte match, which rules out almost every
+// position on real text before memcmp is reached.
+size_t FindSse2(const char* text, size_t n, const char* pattern, size_t m) {
+  const __m128i first = _mm_set1_epi8(pattern[0]);
+  const __m128i last = _mm_set1_epi8(pattern[m - 1]);
+  size_t misses = 0;
+  size_t i = 0;
+  for (; i + m - 1 + 16 <= n; i += 16) {
+    __m128i block_first =
+        _mm_loadu_si128(reinterpret_cast<const __m128i*>(text + i));
+    __m128i block_last =
+        _mm_loadu_si128(reinterpret_cast<const __m128i*>(text + i + m - 1));
+    unsigned mask = _mm_movemask_epi8(_mm_and_si128(
+        _mm_cmpeq_epi8(block_first, first), _mm_cmpeq_epi8(block_last, last)));
+    while (mask != 0) {
+      size_t bit = __builtin_ctz(mask);
+      if (std::memcmp(text + i + bit + 1, pattern + 1, m - 2) == 0) {
+        return i + bit;
+      }
+      mask &= mask - 1;
+      ++misses;
+    }
+    if (SearchBudgetExceeded(misses, m, i)) {
+      return TwoWaySearch(ForwardReader{text}, n, ForwardReader{pattern}, m,
+                          i + 16);
+    }
+  }
+  return FindTail(text, n, pattern, m, i);
+}
 
-  void push_back(char symb) {
-    if (size_ == capacity_) {
-      capacity_ = 2 * capacity_ + 1;
-      char* new_string = new char[capacity_ + 1];
-      std::copy(elements + 0, elements + size_, new_string);
-      delete[] elements;
-      elements = new_string;
+size_t RfindSse2(const char* text, size_t n, const char* pattern, size_t m) {
+  const __m128i first = _mm_set1_epi8(pattern[0]);
+  const __m128i last = _mm_set1_epi8(pattern[m - 1]);
+  size_t misses = 0;
+  size_t end = n - m + 1;  // candidate starts below `end` are unchecked
+  for (; end >= 16; end -= 16) {
+    size_t i = end - 16;
+    __m128i block_first =
+        _mm_loadu_si128(reinterpret_cast<const __m128i*>(text + i));
+    __m128i block_last =
+        _mm_loadu_si128(reinterpret_cast<const __m128i*>(text + i + m - 1));
+    unsigned mask = _mm_movemask_epi8(_mm_and_si128(
+        _mm_cmpeq_epi8(block_first, first), _mm_cmpeq_epi8(block_last, last)));
+    while (mask != 0) {
+      size_t bit = 31 - __builtin_clz(mask);
+      if (std::memcmp(text + i + bit + 1, pattern + 1, m - 2) == 0) {
+        return i + bit;
+      }
+      mask &= ~(1u << bit);
+      ++misses;
+    }
+    if (SearchBudgetExceeded(misses, m, n - i)) {
+      size_t found = TwoWaySearch(ReverseReader{text + n}, n,
+                                  ReverseReader{pattern + m}, m, n - m - i + 1);
+      return found == n ? n : n - m - found;
     }
-    elements[size_++] = symb;
-    elements[size_] = '\0';
   }
+  return RfindTail(text, n, pattern, m, end);
+}
 
-  void pop_back() { elements[size_--] = '\0'; }
+__attribute__((target("avx2"))) uint64_t CandidatesAvx2(const char* text,
+                                                        size_t m,
+                                                        __m256i first,
+                                                        __m256i last) {
+  __m256i low_first =
+      _mm256_loadu_si256(reinterpret_cast<const __m256i*>(text));
+  __m256i low_last =
+      _mm256_loadu_si256(reinterpret_cast<const __m256i*>(text + m - 1));
+  __m256i high_first =
+      _mm256_loadu_si256(reinterpret_cast<const __m256i*>(text + 32));
+  __m256i high_last =
+      _mm256_loadu_si256(reinterpret_cast<const __m256i*>(text + m + 31));
+  uint32_t low = _mm256_movemask_epi8(_mm256_and_si256(
+      _mm256_cmpeq_epi8(low_first, first), _mm256_cmpeq_epi8(low_last, last)));
+  uint32_t high = _mm256_movemask_epi8(
+      _mm256_and_si256(_mm256_cmpeq_epi8(high_first, first),
+                       _mm256_cmpeq_epi8(high_last, last)));
+  return (static_cast<uint64_t>(high) << 32) | low;
+}
 
-  char& front() { return elements[0]; }
-  const char& front() const { return elements[0]; }
-  char& back() { return elements[size_ - 1]; }
-  const char& back() const { return elements[size_ - 1]; }
+__attribute__((target("avx2"))) size_t FindAvx2(const char* text, size_t n,
+                                                const char* pattern,
+                                                size_t m) {
+  const __m256i first = _mm256_set1_epi8(pattern[0]);
+  const __m256i last = _mm256_set1_epi8(pattern[m - 1]);
+  size_t misses = 0;
+  size_t i = 0;
+  for (; i + m - 1 + 64 <= n; i += 64) {
+    uint64_t mask = CandidatesAvx2(text + i, m, first, last);
+    while (mask != 0) {
+      size_t bit = __builtin_ctzll(mask);
+      if (std::memcmp(text + i + bit + 1, pattern + 1, m - 2) == 0) {
+        return i + bit;
+      }
+      mask &= mask - 1;
+      ++misses;
+    }
+    if (SearchBudgetExceeded(misses, m, i)) {
+      return TwoWaySearch(ForwardReader{text}, n, ForwardReader{pattern}, m,
+                          i + 64);
+    }
+  }
+  return FindTail(text, n, pattern, m, i);
+}
 
-  String& operator+=(const char symb) {
-    push_back(symb);
-    return *this;
+__attribute__((target("avx2"))) size_t RfindAvx2(const char* text, size_t n,
+                                                 const char* pattern,
+                                                 size_t m) {
+  const __m256i first = _mm256_set1_epi8(pattern[0]);
+  const __m256i last = _mm256_set1_epi8(pattern[m - 1]);
+  size_t misses = 0;
+  size_t end = n - m + 1;
+  for (; end >= 64; end -= 64) {
+    size_t i = end - 64;
+    uint64_t mask = CandidatesAvx2(text + i, m, first, last);
+    while (mask != 0) {
+      size_t bit = 63 - __builtin_clzll(mask);
+      if (std::memcmp(text + i + bit + 1, pattern + 1, m - 2) == 0) {
+        return i + bit;
+      }
+      mask &= ~(uint64_t{1} << bit);
+      ++misses;
+    }
+    if (SearchBudgetExceeded(misses, m, n - i)) {
+      size_t found = TwoWaySearch(ReverseReader{text + n}, n,
+                                  ReverseReader{pattern + m}, m, n - m - i + 1);
+      return found == n ? n : n - m - found;
+    }
   }
-  String& operator+=(const String& str) {
-    if (capacity_ < str.size_ + size_) {
-      capacity_ = std::max(str.size_ + size_ + 1, 2 * capacity_ + 1);
-      char* new_string = new char[capacity_ + 1];
-      std::copy(elements, elements + size_, new_string);
-      delete[] elements;
-      elements = new_string;
+  return RfindTail(text, n, pattern, m, end);
+}
+#endif
+
+struct SearchKernel {
+  size_t (*find)(const char*, size_t, const char*, size_t);
+  size_t (*rfind)(const char*, size_t, const char*, size_t);
+};
+
+const SearchKernel& GetSearchKernel() {
+  static const SearchKernel kernel = [] {
+#ifdef STRING_X86_SIMD
+    if (__builtin_cpu_supports("avx2")) {
+      return SearchKernel{FindAvx2, RfindAvx2};
     }
-    std::copy(str.elements, str.elements + str.size_, elements + size_);
-    size_ += str.size_;
-    elements[size_] = '\0';
-    return *this;
+    return SearchKernel{FindSse2, RfindSse2};
+#else
+    return SearchKernel{FindScalar, RfindScalar};
+#endif
+  }();
+  return kernel;
+}
+
+// Both return `text_size` when there is no occurrence.
+size_t SearchForward(const char* text, size_t text_size, const char* pattern,
+                     size_t pattern_size) {
+  if (pattern_size == 0) {
+    return 0;
   }
-  size_t find(const String& str) const {
-    bool flag = false;
-    size_t index = 0;
-    for (size_t i = 0; i < size_; ++i) {
-      if (i + str.size_ > size_) {
-        return length();
-      }
-      if (elements[i] == str[0]) {
-        index = i;
-        flag = true;
-        for (size_t j = i + 1; j < i + str.size_; ++j) {
-          if (j >= size_ || elements[j] != str[j - i]) {
-            flag = false;
-            break;
-          }
-        }
-        if (flag) return index;
-      }
-    }
-    if (flag) return index;
-    return length();
-  }
-  size_t rfind(const String& str) const {
-    bool flag = false;
-    if (size_ == 0) {
-      return length();
-    }
-    size_t index = size_ - 1;
-    size_t i = size_;
-    do {
-      --i;
-      if (elements[i] == str[str.size_ - 1]) {
-        index = i;
-        flag = true;
-        if (i < str.size_ - 1) {
-          flag = false;
-          break;
-        }
-        for (size_t j = 1; j < str.size_; ++j) {
-          if (elements[i - j] != str[str.size_ - 1 - j]) {
-            flag = false;
-            break;
-          }
-        }
-        if (flag) {
-          return index - str.size_ + 1;
-        }
-      }
-    } while (i != 0);
-    if (flag) {
-      return index - str.size_ + 1;
+  if (pattern_size > text_size) {
+    return text_size;
+  }
+  if (pattern_size == 1) {
+    const void* hit = std::memchr(text, pattern[0], text_size);
+    return hit == nullptr ? text_size : static_cast<const char*>(hit) - text;
+  }
+  return GetSearchKernel().find(text, text_size, pattern, pattern_size);
+}
+
+size_t SearchBackward(const char* text, size_t text_size, const char* pattern,
+                      size_t pattern_size) {
+  if (pattern_size == 0 || pattern_size > text_size) {
+    return text_size;
+  }
+  if (pattern_size == 1) {
+    return RfindTail(text, text_size, pattern, 1, text_size);
+  }
+  return GetSearchKernel().rfind(text, text_size, pattern, pattern_size);
+}
+
+// wyhash-style mixing for short inputs; inputs of kLongHash bytes and more
+// run XXH3-style 64-byte stripes through eight independent accumulators,
+// which the SSE2/AVX2 kernels process in parallel. Every path is also a
+// constant expression and the kernels agree bit for bit, so a hash computed
+// at compile time matches one computed at runtime.
+constexpr uint64_t kHashPrime[4] = {0x2d358dccaa6c78a5ull,
+                                    0x8bb84b93962eacc9ull,
+                                    0x4b33a62ed433d4a3ull,
+                                    0x4d5a2da51de1aa47ull};
+// Stripe s of a scramble block keys lane l with kStripeKey[s + l], so equal
+// stripes at different offsets contribute differently.
+constexpr uint64_t kStripeKey[23] = {
+    0x3bb548a553e612baull, 0x4069ce2edb035080ull, 0xff06faea22f367beull,
+    0x9605e6bc306bb0e4ull, 0xc3cbc109943d092dull, 0xa061048c23a937bfull,
+    0x55301840bce768cdull, 0xfaf89a7d66b31842ull, 0x9446c21956b2873full,
+    0xc191d9eebaa7b915ull, 0x8a04555b94b5abcdull, 0xb8e62a7e4c9e9a29ull,
+    0x6c7ae6de473ad82dull, 0xac95eae8ad77aebeull, 0x595154ec6e4d0ba2ull,
+    0xadb9c6f69f2b6c7aull, 0x88e49aa758539d3dull, 0xa36f21d2775edd21ull,
+    0xfd9fc955ac8da3ebull, 0xd201040ab03c989full, 0x3a6081b3879aa779ull,
+    0x56baae4297cd72bcull, 0xee9a535d7b4e6df0ull};
+constexpr uint64_t kScrambleKey[8] = {
+    0x74cd8258f9520068ull, 0x55c74a62e116868bull, 0xd2f4c799a2023cbdull,
+    0xdf98cb79a37b51b9ull, 0x396f5885524f3905ull, 0xaf1d56386ca3b276ull,
+    0xa9ffbe6b5104e85aull, 0x6bd0c51b9fd533b3ull};
+constexpr uint64_t kScramblePrime = 0x9E3779B1ull;
+constexpr size_t kHashStripe = 64;
+constexpr size_t kStripesPerScramble = 16;
+constexpr size_t kLongHash = 256;
+
+constexpr uint64_t HashMix(uint64_t first, uint64_t second) {
+  __uint128_t product = static_cast<__uint128_t>(first) * second;
+  return static_cast<uint64_t>(product) ^
+         static_cast<uint64_t>(product >> 64);
+}
+
+// Little-endian loads; the byte loops only run during constant evaluation.
+constexpr uint64_t Read64(const char* data) {
+  if (!std::is_constant_evaluated() &&
+      std::endian::native == std::endian::little) {
+    uint64_t value;
+    std::memcpy(&value, data, sizeof(value));
+    return value;
+  }
+  uint64_t value = 0;
+  for (int i = 7; i >= 0; --i) {
+    value = (value << 8) | static_cast<unsigned char>(data[i]);
+  }
+  return value;
+}
+
+constexpr uint64_t Read32(const char* data) {
+  if (!std::is_constant_evaluated() &&
+      std::endian::native == std::endian::little) {
+    uint32_t value;
+    std::memcpy(&value, data, sizeof(value));
+    return value;
+  }
+  uint64_t value = 0;
+  for (int i = 3; i >= 0; --i) {
+    value = (value << 8) | static_cast<unsigned char>(data[i]);
+  }
+  return value;
+}
+
+constexpr uint64_t HashShort(const char* data, size_t size, uint64_t seed) {
+  seed ^= HashMix(seed ^ kHashPrime[0], kHashPrime[1]);
+  uint64_t first = 0;
+  uint64_t second = 0;
+  if (size <= 16) {
+    if (size >= 4) {
+      size_t shift = (size >> 3) << 2;
+      first = (Read32(data) << 32) | Read32(data + shift);
+      second = (Read32(data + size - 4) << 32) |
+               Read32(data + size - 4 - shift);
+    } else if (size > 0) {
+      first = (static_cast<uint64_t>(static_cast<unsigned char>(data[0]))
+               << 16) |
+              (static_cast<uint64_t>(
+                   static_cast<unsigned char>(data[size >> 1]))
+               << 8) |
+              static_cast<unsigned char>(data[size - 1]);
     }
-    return length();
+  } else {
+    size_t rest = size;
+    const char* current = data;
+    if (rest > 48) {
+      uint64_t lane1 = seed;
+      uint64_t lane2 = seed;
+      do {
+        seed = HashMix(Read64(current) ^ kHashPrime[1],
+                       Read64(current + 8) ^ seed);
+        lane1 = HashMix(Read64(current + 16) ^ kHashPrime[2],
+                        Read64(current + 24) ^ lane1);
+        lane2 = HashMix(Read64(current + 32) ^ kHashPrime[3],
+                        Read64(current + 40) ^ lane2);
+        current += 48;
+        rest -= 48;
+      } while (rest > 48);
+      seed ^= lane1 ^ lane2;
+    }
+    while (rest > 16) {
+      seed = HashMix(Read64(current) ^ kHashPrime[1],
+                     Read64(current + 8) ^ seed);
+      current += 16;
+      rest -= 16;
+    }
+    first = Read64(current + rest - 16);
+    second = Read64(current + rest - 8);
   }
-  String substr(size_t start, size_t count) const {
-    return String(elements + start, count);
+  __uint128_t product =
+      static_cast<__uint128_t>(first ^ kHashPrime[1]) * (second ^ seed);
+  first = static_cast<uint64_t>(product);
+  second = static_cast<uint64_t>(product >> 64);
+  return HashMix(first ^ kHashPrime[0] ^ size, second ^ kHashPrime[1]);
+}
+
+constexpr void AccumulateScalar(uint64_t* acc, const char* data,
+                                size_t stripes) {
+  for (size_t stripe = 0; stripe < stripes; ++stripe) {
+    for (size_t lane = 0; lane < 8; ++lane) {
+      uint64_t value = Read64(data + 8 * lane);
+      uint64_t keyed = value ^ kStripeKey[stripe + lane];
+      acc[lane ^ 1] += value;
+      acc[lane] += (keyed & 0xFFFFFFFFull) * (keyed >> 32);
+    }
+    data += kHashStripe;
   }
+}
 
-  bool empty() { return size_ == 0; }
-  void clear() {
-    size_ = 0;
-    elements[0] = '\0';
+constexpr void ScrambleScalar(uint64_t* acc) {
+  for (size_t lane = 0; lane < 8; ++lane) {
+    uint64_t value = acc[lane] ^ (acc[lane] >> 47) ^ kScrambleKey[lane];
+    acc[lane] = value * kScramblePrime;
   }
-  void shrink_to_fit() {
-    char* new_elements = new char[size_ + 1];
-    std::copy(elements + 0, elements + size_, new_elements);
-    delete[] elements;
-    capacity_ = size_;
-    elements = new_elements;
+}
+
+#ifdef STRING_X86_SIMD
+void AccumulateSse2(uint64_t* acc, const char* data, size_t stripes) {
+  for (size_t stripe = 0; stripe < stripes; ++stripe) {
+    for (size_t pair = 0; pair < 4; ++pair) {
+      __m128i value = _mm_loadu_si128(
+          reinterpret_cast<const __m128i*>(data + 16 * pair));
+      __m128i key = _mm_loadu_si128(
+          reinterpret_cast<const __m128i*>(kStripeKey + stripe + 2 * pair));
+      __m128i keyed = _mm_xor_si128(value, key);
+      __m128i product = _mm_mul_epu32(keyed, _mm_srli_epi64(keyed, 32));
+      __m128i swapped = _mm_shuffle_epi32(value, _MM_SHUFFLE(1, 0, 3, 2));
+      __m128i* lanes = reinterpret_cast<__m128i*>(acc + 2 * pair);
+      _mm_storeu_si128(lanes,
+                       _mm_add_epi64(_mm_loadu_si128(lanes),
+                                     _mm_add_epi64(product, swapped)));
+    }
+    data += kHashStripe;
   }
+}
 
-  char* data() { return elements + 0; }
-  const char* data() const { return elements + 0; }
-  ~String() { delete[] elements; }
-  friend std::ostream& operator<<(std::ostream& os, const String& a);
-};
+__attribute__((target("avx2"))) void AccumulateAvx2(uint64_t* acc,
+                                                    const char* data,
+                                                    size_t stripes) {
+  __m256i low = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(acc));
+  __m256i high = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(acc + 4));
+  for (size_t stripe = 0; stripe < stripes; ++stripe) {
+    __m256i key_low = _mm256_loadu_si256(
+        reinterpret_cast<const __m256i*>(kStripeKey + stripe));
+    __m256i key_high = _mm256_loadu_si256(
+        reinterpret_cast<const __m256i*>(kStripeKey + stripe + 4));
+    __m256i value_low =
+        _mm256_loadu_si256(reinterpret_cast<const __m256i*>(data));
+    __m256i value_high =
+        _mm256_loadu_si256(reinterpret_cast<const __m256i*>(data + 32));
+    __m256i keyed_low = _mm256_xor_si256(value_low, key_low);
+    __m256i keyed_high = _mm256_xor_si256(value_high, key_high);
+    low = _mm256_add_epi64(
+        low, _mm256_add_epi64(
+                 _mm256_mul_epu32(keyed_low, _mm256_srli_epi64(keyed_low, 32)),
+                 _mm256_shuffle_epi32(value_low, _MM_SHUFFLE(1, 0, 3, 2))));
+    high = _mm256_add_epi64(
+        high,
+        _mm256_add_epi64(
+            _mm256_mul_epu32(keyed_high, _mm256_srli_epi64(keyed_high, 32)),
+            _mm256_shuffle_epi32(value_high, _MM_SHUFFLE(1, 0, 3, 2))));
+    data += kHashStripe;
+  }
+  _mm256_storeu_si256(reinterpret_cast<__m256i*>(acc), low);
+  _mm256_storeu_si256(reinterpret_cast<__m256i*>(acc + 4), high);
+}
+#endif
 
-bool operator==(const String& a, const String& b) {
-  if (a.length() != b.length()) {
-    return false;
+using AccumulateKernel = void (*)(uint64_t*, const char*, size_t);
+
+AccumulateKernel GetAccumulateKernel() {
+  static const AccumulateKernel kernel = [] {
+#ifdef STRING_X86_SIMD
+    if (__builtin_cpu_supports("avx2")) {
+      return static_cast<AccumulateKernel>(AccumulateAvx2);
+    }
+    return static_cast<AccumulateKernel>(AccumulateSse2);
+#else
+    return static_cast<AccumulateKernel>(
+        [](uint64_t* acc, const char* data, size_t stripes) {
+          AccumulateScalar(acc, data, stripes);
+        });
+#endif
+  }();
+  return kernel;
+}
+
+constexpr uint64_t HashLong(const char* data, size_t size, uint64_t seed) {
+  uint64_t acc[8] = {kHashPrime[0], kHashPrime[1], kHashPrime[2],
+                     kHashPrime[3], kStripeKey[0], kStripeKey[1],
+                     kStripeKey[2], kStripeKey[3]};
+  size_t stripes = size / kHashStripe;
+  for (size_t done = 0; done < stripes; done += kStripesPerScramble) {
+    size_t count = std::min(kStripesPerScramble, stripes - done);
+    const char* block = data + done * kHashStripe;
+    if (std::is_constant_evaluated()) {
+      AccumulateScalar(acc, block, count);
+    } else {
+      GetAccumulateKernel()(acc, block, count);
+    }
+    ScrambleScalar(acc);
+  }
+  uint64_t hash = seed ^ (size * kHashPrime[2]);
+  for (size_t lane = 0; lane < 8; lane += 2) {
+    hash ^= HashMix(acc[lane] ^ kScrambleKey[lane],
+                    acc[lane + 1] ^ kScrambleKey[lane + 1]);
+  }
+  return HashShort(data + stripes * kHashStripe, size % kHashStripe, hash);
+}
+
+constexpr size_t HashBytes(const char* data, size_t size, uint64_t seed = 0) {
+  return size < kLongHash ? HashShort(data, size, seed)
+                          : HashLong(data, size, seed);
+}
+
+// Decodes the UTF-8 sequence at the start of [data, data + size) into
+// `code_point` and returns its length, or returns 0 if the sequence is
+// malformed, truncated, overlong, a surrogate or above U+10FFFF.
+inline size_t DecodeUtf8(const char* data, size_t size, char32_t& code_point) {
+  const auto* bytes = reinterpret_cast<const unsigned char*>(data);
+  unsigned char lead = bytes[0];
+  if (lead < 0x80) {
+    code_point = lead;
+    return 1;
+  }
+  size_t length;
+  char32_t min;
+  if ((lead & 0xE0) == 0xC0) {
+    length = 2;
+    min = 0x80;
+    code_point = lead & 0x1F;
+  } else if ((lead & 0xF0) == 0xE0) {
+    length = 3;
+    min = 0x800;
+    code_point = lead & 0x0F;
+  } else if ((lead & 0xF8) == 0xF0) {
+    length = 4;
+    min = 0x10000;
+    code_point = lead & 0x07;
+  } else {
+    return 0;
+  }
+  if (size < length) {
+    return 0;
+  }
+  for (size_t i = 1; i < length; ++i) {
+    if ((bytes[i] & 0xC0) != 0x80) {
+      return 0;
+    }
+    code_point = (code_point << 6) | (bytes[i] & 0x3F);
+  }
+  if (code_point < min || code_point > 0x10FFFF ||
+      (code_point >= 0xD800 && code_point <= 0xDFFF)) {
+    return 0;
   }
-  size_t number = a.length();
-  for (size_t i = 0; i < number; ++i) {
-    if (a[i] != b[i]) {
+  return length;
+}
+
+constexpr uint64_t kHighBits = 0x8080808080808080ull;
+
+bool ValidateUtf8Scalar(const char* data, size_t size) {
+  size_t i = 0;
+  while (i < size) {
+    uint64_t word;
+    if (i + 8 <= size) {
+      std::memcpy(&word, data + i, 8);
+      if ((word & kHighBits) == 0) {
+        i += 8;
+        continue;
+      }
+    }
+    char32_t code_point;
+    size_t length = DecodeUtf8(data + i, size - i, code_point);
+    if (length == 0) {
       return false;
     }
+    i += length;
   }
   return true;
 }
-bool operator!=(const String& str_a, const String& str_b) {
-  return !(str_a == str_b);
+
+// Every byte except the continuation bytes 10xxxxxx starts a code point.
+size_t CountUtf8Scalar(const char* data, size_t size) {
+  size_t continuations = 0;
+  size_t i = 0;
+  for (; i + 8 <= size; i += 8) {
+    uint64_t word;
+    std::memcpy(&word, data + i, 8);
+    continuations += std::popcount(word & ~(word << 1) & kHighBits);
+  }
+  for (; i < size; ++i) {
+    continuations += (data[i] & 0xC0) == 0x80;
+  }
+  return size - continuations;
 }
-bool operator<(const String& str_a, const String& str_b) {
-  for (size_t i = 0; i < str_a.length(); ++i) {
-    if ((i >= str_b.length() && i < str_a.length()) || str_a[i] > str_b[i]) {
-      return false;
+
+#ifdef STRING_X86_SIMD
+size_t CountUtf8Sse2(const char* data, size_t size) {
+  const __m128i last_continuation = _mm_set1_epi8(-65);  // 0xBF
+  __m128i total = _mm_setzero_si128();
+  size_t i = 0;
+  while (i + 16 <= size) {
+    // byte counters, flushed before they can wrap
+    __m128i counts = _mm_setzero_si128();
+    for (size_t round = 0; round < 255 && i + 16 <= size; ++round, i += 16) {
+      __m128i block =
+          _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + i));
+      counts = _mm_sub_epi8(counts, _mm_cmpgt_epi8(block, last_continuation));
     }
+    total = _mm_add_epi64(total, _mm_sad_epu8(counts, _mm_setzero_si128()));
   }
-  return true;
+  return _mm_cvtsi128_si64(total) +
+         _mm_cvtsi128_si64(_mm_unpackhi_epi64(total, total)) +
+         CountUtf8Scalar(data + i, size - i);
 }
-bool operator>=(const String& str_a, const String& str_b) {
-  return !(str_a < str_b);
+
+__attribute__((target("avx2"))) size_t CountUtf8Avx2(const char* data,
+                                                    size_t size) {
+  const __m256i last_continuation = _mm256_set1_epi8(-65);
+  __m256i total = _mm256_setzero_si256();
+  size_t i = 0;
+  while (i + 32 <= size) {
+    __m256i counts = _mm256_setzero_si256();
+    for (size_t round = 0; round < 255 && i + 32 <= size; ++round, i += 32) {
+      __m256i block =
+          _mm256_loadu_si256(reinterpret_cast<const __m256i*>(data + i));
+      counts = _mm256_sub_epi8(counts,
+                               _mm256_cmpgt_epi8(block, last_continuation));
+    }
+    total = _mm256_add_epi64(total,
+                             _mm256_sad_epu8(counts, _mm256_setzero_si256()));
+  }
+  alignas(32) uint64_t lanes[4];
+  _mm256_store_si256(reinterpret_cast<__m256i*>(lanes), total);
+  return lanes[0] + lanes[1] + lanes[2] + lanes[3] +
+         CountUtf8Scalar(data + i, size - i);
 }
-bool operator>(const String& str_a, const String& str_b) {
-  return str_b < str_a;
+
+// Keiser and Lemire's validator: three 16-entry nibble tables classify every
+// pair of adjacent bytes into error bits, and the bytes that must be the
+// second or third continuation of a longer sequence are checked separately
+// from the lead two and three bytes back. An all-ASCII block only has to
+// confirm that the previous block did not end inside a sequence.
+constexpr uint8_t kTooShort = 1 << 0;  // lead not followed by continuation
+constexpr uint8_t kTooLong = 1 << 1;   // continuation after ASCII
+constexpr uint8_t kOverlong3 = 1 << 2;
+constexpr uint8_t kTooLarge = 1 << 3;
+constexpr uint8_t kSurrogate = 1 << 4;
+constexpr uint8_t kOverlong2 = 1 << 5;
+constexpr uint8_t kTooLarge1000 = 1 << 6;
+constexpr uint8_t kOverlong4 = 1 << 6;
+constexpr uint8_t kTwoConts = 1 << 7;  // continuation after continuation
+constexpr uint8_t kCarry = kTooShort | kTooLong | kTwoConts;
+
+// Indexed by the high nibble of the first byte of a pair.
+constexpr uint8_t kUtf8FirstHigh[16] = {
+    kTooLong,   kTooLong,   kTooLong,   kTooLong,
+    kTooLong,   kTooLong,   kTooLong,   kTooLong,
+    kTwoConts,  kTwoConts,  kTwoConts,  kTwoConts,
+    kTooShort | kOverlong2,
+    kTooShort,
+    kTooShort | kOverlong3 | kSurrogate,
+    kTooShort | kTooLarge | kTooLarge1000 | kOverlong4};
+// Indexed by the low nibble of the first byte.
+constexpr uint8_t kUtf8FirstLow[16] = {
+    kCarry | kOverlong3 | kOverlong2 | kOverlong4,
+    kCarry | kOverlong2,
+    kCarry,
+    kCarry,
+    kCarry | kTooLarge,
+    kCarry | kTooLarge | kTooLarge1000,
+    kCarry | kTooLarge | kTooLarge1000,
+    kCarry | kTooLarge | kTooLarge1000,
+    kCarry | kTooLarge | kTooLarge1000,
+    kCarry | kTooLarge | kTooLarge1000,
+    kCarry | kTooLarge | kTooLarge1000,
+    kCarry | kTooLarge | kTooLarge1000,
+    kCarry | kTooLarge | kTooLarge1000,
+    kCarry | kTooLarge | kTooLarge1000 | kSurrogate,
+    kCarry | kTooLarge | kTooLarge1000,
+    kCarry | kTooLarge | kTooLarge1000};
+// Indexed by the high nibble of the second byte.
+constexpr uint8_t kUtf8SecondHigh[16] = {
+    kTooShort, kTooShort, kTooShort, kTooShort,
+    kTooShort, kTooShort, kTooShort, kTooShort,
+    kTooLong | kOverlong2 | kTwoConts | kOverlong3 | kTooLarge1000 |
+        kOverlong4,
+    kTooLong | kOverlong2 | kTwoConts | kOverlong3 | kTooLarge,
+    kTooLong | kOverlong2 | kTwoConts | kSurrogate | kTooLarge,
+    kTooLong | kOverlong2 | kTwoConts | kSurrogate | kTooLarge,
+    kTooShort, kTooShort, kTooShort, kTooShort};
+
+__attribute__((target("avx2"))) __m256i LoadUtf8Table(const uint8_t* table) {
+  return _mm256_broadcastsi128_si256(
+      _mm_loadu_si128(reinterpret_cast<const __m128i*>(table)));
 }
-bool operator<=(const String& str_a, const String& str_b) {
-  return !(str_b < str_a);
+
+__attribute__((target("avx2"))) __m256i Utf8BlockErrors(__m256i input,
+                                                        __m256i previous) {
+  const __m256i nibble = _mm256_set1_epi8(0x0F);
+  // input shifted right by 1, 2 and 3 bytes, pulling in `previous`
+  __m256i carried = _mm256_permute2x128_si256(previous, input, 0x21);
+  __m256i prev1 = _mm256_alignr_epi8(input, carried, 15);
+  __m256i prev2 = _mm256_alignr_epi8(input, carried, 14);
+  __m256i prev3 = _mm256_alignr_epi8(input, carried, 13);
+  __m256i first_high = _mm256_shuffle_epi8(
+      LoadUtf8Table(kUtf8FirstHigh),
+      _mm256_and_si256(_mm256_srli_epi16(prev1, 4), nibble));
+  __m256i first_low = _mm256_shuffle_epi8(LoadUtf8Table(kUtf8FirstLow),
+                                          _mm256_and_si256(prev1, nibble));
+  __m256i second_high = _mm256_shuffle_epi8(
+      LoadUtf8Table(kUtf8SecondHigh),
+      _mm256_and_si256(_mm256_srli_epi16(input, 4), nibble));
+  __m256i special =
+      _mm256_and_si256(_mm256_and_si256(first_high, first_low), second_high);
+  // high bit set where the byte two back is >= 0xE0 or three back >= 0xF0
+  __m256i third = _mm256_subs_epu8(prev2, _mm256_set1_epi8(0xE0 - 0x80));
+  __m256i fourth = _mm256_subs_epu8(prev3, _mm256_set1_epi8(0xF0 - 0x80));
+  __m256i must_continue = _mm256_and_si256(_mm256_or_si256(third, fourth),
+                                           _mm256_set1_epi8(char(0x80)));
+  return _mm256_xor_si256(must_continue, special);
+}
+
+__attribute__((target("avx2"))) bool ValidateUtf8Avx2(const char* data,
+                                                     size_t size) {
+  // greater than these in the last three bytes means an unfinished sequence
+  const __m256i incomplete_limit = _mm256_setr_epi8(
+      -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+      -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, 0xF0 - 1, 0xE0 - 1, 0xC0 - 1);
+  __m256i error = _mm256_setzero_si256();
+  __m256i previous = _mm256_setzero_si256();
+  __m256i incomplete = _mm256_setzero_si256();
+  // the zero-padded last block also flags a sequence cut off by the end
+  size_t full = size / 32 * 32;
+  char tail[32] = {};
+  std::memcpy(tail, data + full, size - full);
+  for (size_t i = 0; i <= full; i += 32) {
+    const char* block = i == full ? tail : data + i;
+    __m256i input = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(block));
+    if (_mm256_movemask_epi8(input) == 0) {
+      error = _mm256_or_si256(error, incomplete);
+    } else {
+      error = _mm256_or_si256(error, Utf8BlockErrors(input, previous));
+      incomplete = _mm256_subs_epu8(input, incomplete_limit);
+    }
+    previous = input;
+  }
+  return _mm256_testz_si256(error, error);
+}
+#endif
+
+struct Utf8Kernel {
+  bool (*validate)(const char*, size_t);
+  size_t (*count)(const char*, size_t);
+};
+
+const Utf8Kernel& GetUtf8Kernel() {
+  static const Utf8Kernel kernel = [] {
+#ifdef STRING_X86_SIMD
+    if (__builtin_cpu_supports("avx2")) {
+      return Utf8Kernel{ValidateUtf8Avx2, CountUtf8Avx2};
+    }
+    return Utf8Kernel{ValidateUtf8Scalar, CountUtf8Sse2};
+#else
+    return Utf8Kernel{ValidateUtf8Scalar, CountUtf8Scalar};
+#endif
+  }();
+  return kernel;
 }
-String operator+(const String& str_a, const String& str_b) {
-  String new_string(str_a);
-  new_string += str_b;
-  return new_string;
+
+bool IsValidUtf8(const char* data, size_t size) {
+  return GetUtf8Kernel().validate(data, size);
 }
-std::ostream& operator<<(std::ostream& os, const String& a) {
-  os << a.elements;
-  return os;
+
+// Exact for valid UTF-8; otherwise counts the bytes that are not
+// continuation bytes.
+size_t CountCodePoints(const char* data, size_t size) {
+  return GetUtf8Kernel().count(data, size);
 }
-std::istream& operator>>(std::istream& os, String& a) {
-  char symb;
-  String b;
-  while (os.get(symb) && !(std::isspace(symb))) {
-    b.push_back(symb);
+
+// Walks code points; each malformed byte is reported as U+FFFD on its own,
+// so iteration always terminates and never reads past the end.
+class CodePointIterator {
+ private:
+  const char* pos_ = nullptr;
+  const char* end_ = nullptr;
+  char32_t code_point_ = 0;
+  size_t length_ = 0;
+
+  void Decode() {
+    if (pos_ == end_) {
+      return;
+    }
+    length_ = DecodeUtf8(pos_, end_ - pos_, code_point_);
+    if (length_ == 0) {
+      code_point_ = 0xFFFD;
+      length_ = 1;
+    }
+  }
+
+ public:
+  using difference_type = std::ptrdiff_t;
+  using iterator_category = std::forward_iterator_tag;
+  using pointer = const char32_t*;
+  using reference = char32_t;
+  using value_type = char32_t;
+
+  CodePointIterator() {}
+  CodePointIterator(const char* pos, const char* end) : pos_(pos), end_(end) {
+    Decode();
+  }
+
+  char32_t operator*() const { return code_point_; }
+  // Where the current code point's bytes start.
+  const char* position() const { return pos_; }
+
+  CodePointIterator& operator++() {
+    pos_ += length_;
+    Decode();
+    return *this;
+  }
+  CodePointIterator operator++(int) {
+    CodePointIterator copy = *this;
+    ++*this;
+    return copy;
+  }
+
+  friend bool operator==(const CodePointIterator& it_a,
+                         const CodePointIterator& it_b) {
+    return it_a.pos_ == it_b.pos_;
   }
-  a = b;
-  return os;
+  friend bool operator!=(const CodePointIterator& it_a,
+                         const CodePointIterator& it_b) {
+    return !(it_a == it_b);
+  }
+};
+
+class CodePointRange {
+ private:
+  const char* begin_;
+  const char* end_;
+
+ public:
+  CodePointRange(const char* begin, const char* end)
+      : begin_(begin), end_(end) {}
+  CodePointIterator begin() const { return CodePointIterator(begin_, end_); }
+  CodePointIterator end() const { return CodePointIterator(end_, end_); }
+};
+
+class SplitRange;
+
+// Non-owning window into characters owned by someone else (usually a
+// String); it must not outlive them.
+class StringView {
+ private:
+  const char* data_ = "";
+  size_t size_ = 0;
+
+ public:
+  constexpr StringView() {}
+  StringView(const char* str) : data_(str), size_(strlen(str)) {}
+  constexpr StringView(const char* str, size_t sz) : data_(str), size_(sz) {}
+
+  constexpr size_t length() const { return size_; }
+  constexpr size_t size() const { return size_; }
+  constexpr bool empty() const { return size_ == 0; }
+  constexpr const char* data() const { return data_; }
+  const char& operator[](size_t index) const { return data_[index]; }
+  const char& front() const { return data_[0]; }
+  const char& back() const { return data_[size_ - 1]; }
+  const char* begin() const { return data_; }
+  const char* end() const { return data_ + size_; }
+
+  size_t find(StringView str) const {
+    return SearchForward(data_, size_, str.data_, str.size_);
+  }
+  size_t rfind(StringView str) const {
+    return SearchBackward(data_, size_, str.data_, str.size_);
+  }
+  StringView substr(size_t start, size_t count) const {
+    return StringView(data_ + start, count);
+  }
+  SplitRange split(char delim) const;
+
+  bool is_valid_utf8() const { return IsValidUtf8(data_, size_); }
+  size_t code_point_count() const { return CountCodePoints(data_, size_); }
+  CodePointRange code_points() const {
+    return CodePointRange(data_, data_ + size_);
+  }
+};
+
+bool operator==(StringView str_a, StringView str_b) {
+  return str_a.size() == str_b.size() &&
+         std::memcmp(str_a.data(), str_b.data(), str_a.size()) == 0;
+}
+bool operator!=(StringView str_a, StringView str_b) {
+  return !(str_a == str_b);
+}
+bool operator<(StringView str_a, StringView str_b) {
+  int cmp = std::memcmp(str_a.data(), str_b.data(),
+                        std::min(str_a.size(), str_b.size()));
+  return cmp < 0 || (cmp == 0 && str_a.size() < str_b.size());
+}
+bool operator>=(StringView str_a, StringView str_b) {
+  return !(str_a < str_b);
+}
+bool operator>(StringView str_a, StringView str_b) { return str_b < str_a; }
+bool operator<=(StringView str_a, StringView str_b) {
+  return !(str_b < str_a);
+}
+
+// Result of the "..."_s literal: a view of the literal's static storage whose
+// length and hash are computed by the compiler. It hashes like String and
+// StringView, so it probes StringHash containers and StringPool directly.
+class StringLiteral {
+ private:
+  const char* data_;
+  size_t size_;
+  size_t hash_;
+
+  constexpr StringLiteral(const char* str, size_t sz)
+      : data_(str), size_(sz), hash_(HashBytes(str, sz)) {}
+
+ public:
+  constexpr size_t length() const { return size_; }
+  constexpr size_t size() const { return size_; }
+  constexpr const char* data() const { return data_; }
+  constexpr size_t hash() const { return hash_; }
+  constexpr operator StringView() const { return StringView(data_, size_); }
+
+  friend consteval StringLiteral operator""_s(const char* str, size_t sz);
+};
+
+consteval StringLiteral operator""_s(const char* str, size_t sz) {
+  return StringLiteral(str, sz);
 }
+
+// Yields the fields between delimiters lazily, as views into the source;
+// n delimiters always give n + 1 fields.
+class SplitIterator {
+ private:
+  const char* field_ = nullptr;  // nullptr once past the last field
+  const char* field_end_ = nullptr;
+  const char* end_ = nullptr;
+  char delim_ = '\0';
+
+  void FindFieldEnd() {
+    const void* hit = std::memchr(field_, delim_, end_ - field_);
+    field_end_ = hit == nullptr ? end_ : static_cast<const char*>(hit);
+  }
+
+ public:
+  using difference_type = std::ptrdiff_t;
+  using iterator_category = std::forward_iterator_tag;
+  using pointer = const StringView*;
+  using reference = StringView;
+  using value_type = StringView;
+
+  SplitIterator() {}
+  SplitIterator(StringView str, char delim)
+      : field_(str.begin()), end_(str.end()), delim_(delim) {
+    FindFieldEnd();
+  }
+
+  StringView operator*() const {
+    return StringView(field_, field_end_ - field_);
+  }
+
+  SplitIterator& operator++() {
+    if (field_end_ == end_) {
+      field_ = nullptr;
+    } else {
+      field_ = field_end_ + 1;
+      FindFieldEnd();
+    }
+    return *this;
+  }
+
+  SplitIterator operator++(int) {
+    auto temp = *this;
+    ++*this;
+    return temp;
+  }
+
+  bool operator==(const SplitIterator& other) const {
+    return field_ == other.field_;
+  }
+  bool operator!=(const SplitIterator& other) const {
+    return !(*this == other);
+  }
+};
+
+class SplitRange {
+ private:
+  StringView str_;
+  char delim_;
+
+ public:
+  SplitRange(StringView str, char delim) : str_(str), delim_(delim) {}
+  SplitIterator begin() const { return SplitIterator(str_, delim_); }
+  SplitIterator end() const { return SplitIterator(); }
+};
+
+SplitRange StringView::split(char delim) const {
+  return SplitRange(*this, delim);
+}
+
+// Growth policies pick the new capacity when an append overflows the buffer;
+// Next(capacity, required) must return at least `required`.
+struct DoublingGrowth {
+  static size_t Next(size_t capacity, size_t required) {
+    return std::max(required, 2 * capacity + 1);
+  }
+};
+
+// Grows by half: more reallocations, but less memory sits idle at the end of
+// a huge buffer, and with a non-moving allocator freed blocks can be reused.
+struct HalfGrowth {
+  static size_t Next(size_t capacity, size_t required) {
+    return std::max(required, capacity + capacity / 2 + 1);
+  }
+};
+
+// Allocator for strings that grow into the gigabytes: blocks of at least
+// kMapThreshold bytes are whole pages mapped from the kernel and resized with
+// mremap, which moves page table entries rather than the bytes, so appending
+// costs no copies however often the buffer grows. Smaller blocks come from
+// operator new. Where mremap is unavailable every block takes that path.
+template <typename T>
+class MappedAllocator {
+ private:
+  static constexpr size_t kMapThreshold = size_t(1) << 20;
+
+  static size_t PageSize() {
+#ifdef STRING_MREMAP
+    static const size_t page = sysconf(_SC_PAGESIZE);
+    return page;
+#else
+    return 1;
+#endif
+  }
+
+  static bool IsMapped([[maybe_unused]] size_t bytes) {
+#ifdef STRING_MREMAP
+    return bytes >= kMapThreshold;
+#else
+    return false;
+#endif
+  }
+
+  static size_t RoundUp(size_t bytes) {
+    return (bytes + PageSize() - 1) & ~(PageSize() - 1);
+  }
+
+ public:
+  using value_type = T;
+
+  MappedAllocator() = default;
+  template <typename U>
+  MappedAllocator(const MappedAllocator<U>&) {}
+
+  T* allocate(size_t count) {
+    size_t bytes = count * sizeof(T);
+#ifdef STRING_MREMAP
+    if (IsMapped(bytes)) {
+      void* block = mmap(nullptr, RoundUp(bytes), PROT_READ | PROT_WRITE,
+                         MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+      if (block == MAP_FAILED) {
+        throw std::bad_alloc();
+      }
+      return static_cast<T*>(block);
+    }
+#endif
+    return static_cast<T*>(::operator new(bytes));
+  }
+
+  void deallocate(T* ptr, size_t count) {
+    size_t bytes = count * sizeof(T);
+#ifdef STRING_MREMAP
+    if (IsMapped(bytes)) {
+      munmap(ptr, RoundUp(bytes));
+      return;
+    }
+#endif
+    ::operator delete(ptr);
+  }
+
+  // Resizes a block of `old_count` elements whose first `used` are live.
+  T* reallocate(T* ptr, size_t old_count, size_t new_count, size_t used) {
+    size_t old_bytes = old_count * sizeof(T);
+    size_t new_bytes = new_count * sizeof(T);
+#ifdef STRING_MREMAP
+    if (IsMapped(old_bytes) && IsMapped(new_bytes)) {
+      void* block = mremap(ptr, RoundUp(old_bytes), RoundUp(new_bytes),
+                           MREMAP_MAYMOVE);
+      if (block == MAP_FAILED) {
+        throw std::bad_alloc();
+      }
+      return static_cast<T*>(block);
+    }
+#endif
+    T* block = allocate(new_count);
+    std::memcpy(block, ptr, std::min(used, new_count) * sizeof(T));
+    deallocate(ptr, old_count);
+    return block;
+  }
+
+  // Mapped blocks are whole pages; report the slack as usable.
+  size_t good_size(size_t count) const {
+    size_t bytes = count * sizeof(T);
+    return IsMapped(bytes) ? RoundUp(bytes) / sizeof(T) : count;
+  }
+
+  template <typename U>
+  bool operator==(const MappedAllocator<U>&) const {
+    return true;
+  }
+  template <typename U>
+  bool operator!=(const MappedAllocator<U>&) const {
+    return false;
+  }
+};
+
+template <typename Alloc, typename Growth>
+class BasicString;
+
+using String = BasicString<std::allocator<char>, DoublingGrowth>;
+
+template <typename T>
+struct IsBasicString : std::false_type {};
+
+template <typename Alloc, typename Growth>
+struct IsBasicString<BasicString<Alloc, Growth>> : std::true_type {};
+
+// Lazy result of operator+: holds its operands until it is materialized, so a
+// chain like a + b + c + d is sized once and copied into a single buffer.
+template <typename Left, typename Right>
+class StringConcat {
+ private:
+  template <typename Piece>
+  using Storage = std::conditional_t<IsBasicString<Piece>::value,
+                                     const Piece&, Piece>;
+
+  Storage<Left> left_;
+  Storage<Right> right_;
+
+  template <typename... A, typename... B>
+  static bool Refers(const BasicString<A...>& piece,
+                     const BasicString<B...>& str) {
+    return static_cast<const void*>(&piece) == &str;
+  }
+  template <typename L, typename R, typename... B>
+  static bool Refers(const StringConcat<L, R>& piece,
+                     const BasicString<B...>& str) {
+    return piece.Contains(str);
+  }
+
+ public:
+  StringConcat(const Left& left, const Right& right)
+      : left_(left), right_(right) {}
+
+  size_t size() const { return left_.size() + right_.size(); }
+
+  void CopyTo(char* out) const {
+    left_.CopyTo(out);
+    right_.CopyTo(out + left_.size());
+  }
+
+  template <typename... A>
+  bool Contains(const BasicString<A...>& str) const {
+    return Refers(left_, str) || Refers(right_, str);
+  }
+};
+
+template <typename L1, typename R1, typename L2, typename R2>
+StringConcat<StringConcat<L1, R1>, StringConcat<L2, R2>> operator+(
+    const StringConcat<L1, R1>& str_a, const StringConcat<L2, R2>& str_b) {
+  return StringConcat<StringConcat<L1, R1>, StringConcat<L2, R2>>(str_a,
+                                                                  str_b);
+}
+
+// Character storage comes from `Alloc` (rebound to char), following the
+// standard propagate_on_container_* rules, so strings can live in an arena
+// such as StackStorage. Strings whose allocator cannot be default-constructed
+// have no implicit conversions and are compared through StringView.
+// Appends grow the capacity as `Growth` says; an allocator that provides
+// reallocate(p, old_n, new_n, used) resizes the buffer itself (in place or by
+// remapping) instead of String copying it, and one that provides
+// good_size(n) lets String use the slack it rounds requests up to.
+template <typename Alloc = std::allocator<char>,
+          typename Growth = DoublingGrowth>
+class BasicString {
+ private:
+  using CharAlloc =
+      typename std::allocator_traits<Alloc>::template rebind_alloc<char>;
+  using CharAlloc_traits =
+      typename std::allocator_traits<Alloc>::template rebind_traits<char>;
+
+  static constexpr size_t kSmallCapacity = 23;  // longest string kept inline
+  static constexpr bool kDefaultAlloc = std::is_default_constructible_v<Alloc>;
+  static constexpr bool kResizable =
+      requires(CharAlloc alloc, char* ptr) {
+        { alloc.reallocate(ptr, size_t(), size_t(), size_t()) }
+            -> std::same_as<char*>;
+      };
+  static constexpr bool kGoodSize =
+      requires(const CharAlloc alloc) { alloc.good_size(size_t()); };
+  static constexpr uint8_t kHashCacheOn = 1;
+  static constexpr uint8_t kHashValid = 2;
+  static constexpr uint8_t kUtf8CacheOn = 4;
+  static constexpr uint8_t kUtf8Checked = 8;  // kUtf8Valid is meaningful
+  static constexpr uint8_t kUtf8Valid = 16;
+  static constexpr uint8_t kCountValid = 32;  // code_points_ is current
+  static constexpr uint8_t kCacheOn = kHashCacheOn | kUtf8CacheOn;
+
+  size_t size_ = 0;
+  size_t capacity_ = kSmallCapacity;
+  char* elements = small_;
+  char small_[kSmallCapacity + 1] = {};
+  [[no_unique_address]] CharAlloc alloc_;
+  mutable size_t hash_ = 0;
+  mutable uint8_t cache_ = 0;
+  mutable uint32_t code_points_ = 0;
+
+  void Touch() { cache_ &= kCacheOn; }
+
+  // Takes over the contents of `tmp`, built to replace ours, along with any
+  // results it has cached; the caching mode stays this string's own.
+  void Replace(BasicString& tmp) {
+    uint8_t mode = cache_ & kCacheOn;
+    swap(tmp);
+    cache_ = (cache_ & ~kCacheOn) | mode;
+  }
+
+  // Adopts `other`'s cached results for contents just copied from it.
+  void TakeHash(const BasicString& other) {
+    hash_ = other.hash_;
+    code_points_ = other.code_points_;
+    cache_ = (cache_ & kCacheOn) | (other.cache_ & ~kCacheOn);
+  }
+
+  bool IsSmall() const { return elements == small_; }
+
+  char* Allocate(size_t capacity) {
+    return CharAlloc_traits::allocate(alloc_, capacity + 1);
+  }
+
+  void Deallocate() {
+    if (!IsSmall()) {
+      CharAlloc_traits::deallocate(alloc_, elements, capacity_ + 1);
+    }
+  }
+
+  void Reallocate(size_t new_capacity) {
+    if constexpr (kGoodSize) {
+      if (new_capacity > kSmallCapacity) {
+        new_capacity = alloc_.good_size(new_capacity + 1) - 1;
+      }
+    }
+    if constexpr (kResizable) {
+      if (!IsSmall() && new_capacity > kSmallCapacity) {
+        elements = alloc_.reallocate(elements, capacity_ + 1,
+                                     new_capacity + 1, size_ + 1);
+        capacity_ = new_capacity;
+        return;
+      }
+    }
+    char* new_elements =
+        new_capacity > kSmallCapacity ? Allocate(new_capacity) : small_;
+    if (new_elements != elements) {
+      std::copy(elements, elements + size_ + 1, new_elements);
+      Deallocate();
+      elements = new_elements;
+    }
+    capacity_ = std::max(new_capacity, kSmallCapacity);
+  }
+
+  void Init(const char* str, size_t sz) {
+    if (sz > kSmallCapacity) {
+      elements = Allocate(sz);
+      capacity_ = sz;
+    }
+    std::copy(str, str + sz, elements);
+    size_ = sz;
+    elements[size_] = '\0';
+  }
+
+  void Assign(const char* str, size_t sz) {
+    Touch();
+    if (capacity_ < sz) {
+      char* new_elements = Allocate(sz);
+      Deallocate();
+      elements = new_elements;
+      capacity_ = sz;
+    }
+    std::copy(str, str + sz, elements);
+    size_ = sz;
+    elements[size_] = '\0';
+  }
+
+  // Takes over `other`'s characters; both must use equal allocators.
+  void Steal(BasicString& other) {
+    size_ = other.size_;
+    capacity_ = other.capacity_;
+    if (other.IsSmall()) {
+      std::copy(other.small_, other.small_ + size_ + 1, small_);
+      elements = small_;
+    } else {
+      elements = other.elements;
+      other.elements = other.small_;
+    }
+    other.size_ = 0;
+    other.capacity_ = kSmallCapacity;
+    other.small_[0] = '\0';
+    other.Touch();
+  }
+
+ public:
+  BasicString() requires(kDefaultAlloc) {}
+
+  explicit BasicString(const Alloc& alloc) : alloc_(alloc) {}
+
+  BasicString(char symb) requires(kDefaultAlloc) : size_(1) {
+    elements[0] = symb;
+    elements[1] = '\0';
+  }
+
+  BasicString(size_t n, char symb, const Alloc& alloc = Alloc())
+      : alloc_(alloc) {
+    Reallocate(n);
+    std::memset(elements, symb, n);
+    size_ = n;
+    elements[n] = '\0';
+  }
+
+  BasicString(const BasicString& str)
+      : alloc_(CharAlloc_traits::select_on_container_copy_construction(
+            str.alloc_)),
+        hash_(str.hash_),
+        cache_(str.cache_),
+        code_points_(str.code_points_) {
+    Init(str.elements, str.size_);
+  }
+
+  BasicString(const BasicString& str, const Alloc& alloc) : alloc_(alloc) {
+    Init(str.elements, str.size_);
+  }
+
+  BasicString(BasicString&& str)
+      : alloc_(std::move(str.alloc_)),
+        hash_(str.hash_),
+        cache_(str.cache_),
+        code_points_(str.code_points_) {
+    Steal(str);
+  }
+
+  template <typename Left, typename Right>
+  BasicString(const StringConcat<Left, Right>& concat) requires(kDefaultAlloc)
+      : BasicString(concat, Alloc()) {}
+
+  template <typename Left, typename Right>
+  BasicString(const StringConcat<Left, Right>& concat, const Alloc& alloc)
+      : alloc_(alloc) {
+    Reallocate(concat.size());
+    concat.CopyTo(elements);
+    size_ = concat.size();
+    elements[size_] = '\0';
+  }
+
+  BasicString(const char* str) requires(kDefaultAlloc) {
+    Init(str, strlen(str));
+  }
+
+  BasicString(const char* str, const Alloc& alloc) : alloc_(alloc) {
+    Init(str, strlen(str));
+  }
+
+  BasicString(const char* el, size_t sz, const Alloc& alloc = Alloc())
+      : alloc_(alloc) {
+    Init(el, sz);
+  }
+
+  explicit BasicString(StringView str, const Alloc& alloc = Alloc())
+      : alloc_(alloc) {
+    Init(str.data(), str.size());
+  }
+
+  // Starts with the literal's precomputed hash in place.
+  explicit BasicString(StringLiteral str, const Alloc& alloc = Alloc())
+      : alloc_(alloc), hash_(str.hash()), cache_(kHashValid) {
+    Init(str.data(), str.size());
+  }
+
+  BasicString& operator=(const BasicString& other) {
+    if (this == &other) {
+      return *this;
+    }
+    if constexpr (CharAlloc_traits::propagate_on_container_copy_assignment::
+                      value) {
+      if (alloc_ != other.alloc_) {
+        Deallocate();
+        elements = small_;
+        capacity_ = kSmallCapacity;
+      }
+      alloc_ = other.alloc_;
+    }
+    Assign(other.elements, other.size_);
+    TakeHash(other);
+    return *this;
+  }
+
+  BasicString& operator=(BasicString&& other) {
+    if (this == &other) {
+      return *this;
+    }
+    TakeHash(other);
+    if constexpr (CharAlloc_traits::propagate_on_container_move_assignment::
+                      value) {
+      Deallocate();
+      alloc_ = std::move(other.alloc_);
+      Steal(other);
+    } else {
+      if (alloc_ == other.alloc_) {
+        Deallocate();
+        Steal(other);
+      } else {
+        Assign(other.elements, other.size_);
+        TakeHash(other);
+      }
+    }
+    return *this;
+  }
+
+  template <typename Left, typename Right>
+  BasicString& operator=(const StringConcat<Left, Right>& concat) {
+    if (concat.size() > capacity_ || concat.Contains(*this)) {
+      BasicString tmp(concat, alloc_);
+      Replace(tmp);
+      return *this;
+    }
+    concat.CopyTo(elements);
+    size_ = concat.size();
+    elements[size_] = '\0';
+    Touch();
+    return *this;
+  }
+
+  // Allocators are exchanged only when they propagate on swap; otherwise
+  // they must compare equal, as for standard containers.
+  void swap(BasicString& other) {
+    if (IsSmall() || other.IsSmall()) {
+      BasicString* small = IsSmall() ? this : &other;
+      BasicString* big = IsSmall() ? &other : this;
+      char buffer[kSmallCapacity + 1];
+      std::copy(small->small_, small->small_ + kSmallCapacity + 1, buffer);
+      if (big->IsSmall()) {
+        std::copy(big->small_, big->small_ + kSmallCapacity + 1,
+                  small->small_);
+      } else {
+        small->elements = big->elements;
+      }
+      std::copy(buffer, buffer + kSmallCapacity + 1, big->small_);
+      big->elements = big->small_;
+    } else {
+      std::swap(elements, other.elements);
+    }
+    std::swap(size_, other.size_);
+    std::swap(capacity_, other.capacity_);
+    std::swap(hash_, other.hash_);
+    std::swap(cache_, other.cache_);
+    std::swap(code_points_, other.code_points_);
+    if constexpr (CharAlloc_traits::propagate_on_container_swap::value) {
+      std::swap(alloc_, other.alloc_);
+    }
+  }
+
+  CharAlloc get_allocator() const { return alloc_; }
+
+  size_t length() const { return size_; }
+  size_t capacity() const { return capacity_; }
+  size_t size() const { return size_; }
+  char* str() {
+    Touch();
+    return elements;
+  }
+  char& operator[](size_t index) {
+    Touch();
+    return elements[index];
+  }
+  const char& operator[](size_t index) const { return elements[index]; }
+
+  void push_back(char symb) {
+    if (size_ == capacity_) {
+      Reallocate(Growth::Next(capacity_, size_ + 1));
+    }
+    elements[size_++] = symb;
+    elements[size_] = '\0';
+    Touch();
+  }
+
+  void pop_back() {
+    elements[--size_] = '\0';
+    Touch();
+  }
+
+  char& front() {
+    Touch();
+    return elements[0];
+  }
+  const char& front() const { return elements[0]; }
+  char& back() {
+    Touch();
+    return elements[size_ - 1];
+  }
+  const char& back() const { return elements[size_ - 1]; }
+
+  BasicString& operator+=(const char symb) {
+    push_back(symb);
+    return *this;
+  }
+  BasicString& operator+=(StringView str) {
+    size_t count = str.size();
+    const char* source = str.data();
+    if (capacity_ < count + size_) {
+      // `str` may look into our own buffer, which Reallocate frees
+      bool inside = source >= elements && source <= elements + size_;
+      size_t offset = source - elements;
+      Reallocate(Growth::Next(capacity_, size_ + count));
+      if (inside) {
+        source = elements + offset;
+      }
+    }
+    std::copy(source, source + count, elements + size_);
+    size_ += count;
+    elements[size_] = '\0';
+    Touch();
+    return *this;
+  }
+  template <typename Left, typename Right>
+  BasicString& operator+=(const StringConcat<Left, Right>& concat) {
+    size_t count = concat.size();
+    if (capacity_ < count + size_) {
+      Reallocate(Growth::Next(capacity_, size_ + count));
+    }
+    concat.CopyTo(elements + size_);
+    size_ += count;
+    elements[size_] = '\0';
+    Touch();
+    return *this;
+  }
+  void CopyTo(char* out) const { std::copy(elements, elements + size_, out); }
+  size_t find(StringView str) const {
+    return SearchForward(elements, size_, str.data(), str.size());
+  }
+  size_t rfind(StringView str) const {
+    return SearchBackward(elements, size_, str.data(), str.size());
+  }
+  BasicString substr(size_t start, size_t count) const {
+    return BasicString(elements + start, count, alloc_);
+  }
+  StringView view(size_t start, size_t count) const {
+    return StringView(elements + start, count);
+  }
+  SplitRange split(char delim) const {
+    return StringView(elements, size_).split(delim);
+  }
+  operator StringView() const { return StringView(elements, size_); }
+
+  // Unlike appends, reserve allocates exactly what is asked for.
+  void reserve(size_t new_capacity) {
+    if (new_capacity > capacity_) {
+      Reallocate(new_capacity);
+    }
+  }
+  void resize(size_t new_size, char symb = '\0') {
+    if (new_size > capacity_) {
+      Reallocate(Growth::Next(capacity_, new_size));
+    }
+    if (new_size > size_) {
+      std::memset(elements + size_, symb, new_size - size_);
+    }
+    size_ = new_size;
+    elements[size_] = '\0';
+    Touch();
+  }
+
+  bool empty() { return size_ == 0; }
+  void clear() {
+    size_ = 0;
+    elements[0] = '\0';
+    Touch();
+  }
+  void shrink_to_fit() {
+    if (!IsSmall() && capacity_ != size_) {
+      BasicString tmp(*this, alloc_);
+      Replace(tmp);
+    }
+  }
+
+  char* data() {
+    Touch();
+    return elements + 0;
+  }
+  const char* data() const { return elements + 0; }
+  // Opt-in: with caching on, hash() is computed once and kept until the
+  // next mutation (including handing out a mutable reference or pointer).
+  // Like any const member that fills a cache, the first hash() call must not
+  // race with other calls on the same string.
+  void cache_hash(bool enable = true) {
+    cache_ = enable ? (cache_ | kHashCacheOn)
+                    : (cache_ & ~(kHashCacheOn | kHashValid));
+  }
+  bool caches_hash() const { return cache_ & kHashCacheOn; }
+  size_t hash() const {
+    if (cache_ & kHashValid) {
+      return hash_;
+    }
+    size_t hash = HashBytes(elements, size_);
+    if (cache_ & kHashCacheOn) {
+      hash_ = hash;
+      cache_ |= kHashValid;
+    }
+    return hash;
+  }
+
+  // Opt-in like cache_hash: the UTF-8 checks below then keep their results
+  // until the next mutation.
+  void cache_utf8(bool enable = true) {
+    cache_ = enable ? (cache_ | kUtf8CacheOn)
+                    : (cache_ & (kHashCacheOn | kHashValid));
+  }
+  bool caches_utf8() const { return cache_ & kUtf8CacheOn; }
+  bool is_valid_utf8() const {
+    if (cache_ & kUtf8Checked) {
+      return cache_ & kUtf8Valid;
+    }
+    bool valid = IsValidUtf8(elements, size_);
+    if (cache_ & kUtf8CacheOn) {
+      cache_ |= valid ? kUtf8Checked | kUtf8Valid : kUtf8Checked;
+    }
+    return valid;
+  }
+  size_t code_point_count() const {
+    if (cache_ & kCountValid) {
+      return code_points_;
+    }
+    size_t count = CountCodePoints(elements, size_);
+    if ((cache_ & kUtf8CacheOn) && count <= UINT32_MAX) {
+      code_points_ = count;
+      cache_ |= kCountValid;
+    }
+    return count;
+  }
+  CodePointRange code_points() const {
+    return CodePointRange(elements, elements + size_);
+  }
+
+  ~BasicString() { Deallocate(); }
+
+  friend bool operator==(const BasicString& str_a, const BasicString& str_b) {
+    return StringView(str_a) == StringView(str_b);
+  }
+  friend bool operator!=(const BasicString& str_a, const BasicString& str_b) {
+    return !(str_a == str_b);
+  }
+  friend bool operator<(const BasicString& str_a, const BasicString& str_b) {
+    return StringView(str_a) < StringView(str_b);
+  }
+  friend bool operator>=(const BasicString& str_a, const BasicString& str_b) {
+    return !(str_a < str_b);
+  }
+  friend bool operator>(const BasicString& str_a, const BasicString& str_b) {
+    return str_b < str_a;
+  }
+  friend bool operator<=(const BasicString& str_a, const BasicString& str_b) {
+    return !(str_b < str_a);
+  }
+
+  friend StringConcat<BasicString, BasicString> operator+(
+      const BasicString& str_a, const BasicString& str_b) {
+    return StringConcat<BasicString, BasicString>(str_a, str_b);
+  }
+  template <typename Left, typename Right>
+  friend StringConcat<StringConcat<Left, Right>, BasicString> operator+(
+      const StringConcat<Left, Right>& str_a, const BasicString& str_b) {
+    return StringConcat<StringConcat<Left, Right>, BasicString>(str_a, str_b);
+  }
+  template <typename Left, typename Right>
+  friend StringConcat<BasicString, StringConcat<Left, Right>> operator+(
+      const BasicString& str_a, const StringConcat<Left, Right>& str_b) {
+    return StringConcat<BasicString, StringConcat<Left, Right>>(str_a, str_b);
+  }
+
+  friend std::ostream& operator<<(std::ostream& os, const BasicString& a) {
+    os << a.elements;
+    return os;
+  }
+  friend std::istream& operator>>(std::istream& os, BasicString& a) {
+    char symb;
+    a.clear();
+    while (os.get(symb) && !(std::isspace(symb))) {
+      a.push_back(symb);
+    }
+    return os;
+  }
+
+  friend class StringPool;
+  template <typename, typename>
+  friend class BasicStringBuilder;
+};
+
+template <typename Alloc, typename Growth>
+struct std::hash<BasicString<Alloc, Growth>> {
+  size_t operator()(const BasicString<Alloc, Growth>& str) const {
+    return str.hash();
+  }
+};
+
+template <>
+struct std::hash<StringView> {
+  size_t operator()(StringView str) const {
+    return HashBytes(str.data(), str.size());
+  }
+};
+
+// Transparent hash and equality: an unordered container keyed by String and
+// declared with these can be probed with a StringView or a literal without
+// building a String.
+struct StringHash {
+  using is_transparent = void;
+  size_t operator()(StringView str) const {
+    return HashBytes(str.data(), str.size());
+  }
+  size_t operator()(StringLiteral str) const { return str.hash(); }
+  template <typename Alloc, typename Growth>
+  size_t operator()(const BasicString<Alloc, Growth>& str) const {
+    return str.hash();
+  }
+};
+
+struct StringEqual {
+  using is_transparent = void;
+  bool operator()(StringView str_a, StringView str_b) const {
+    return str_a == str_b;
+  }
+};
+
+constexpr char kDigitPairs[] =
+    "0001020304050607080910111213141516171819"
+    "2021222324252627282930313233343536373839"
+    "4041424344454647484950515253545556575859"
+    "6061626364656667686970717273747576777879"
+    "8081828384858687888990919293949596979899";
+
+constexpr uint64_t kPowersOf10[20] = {
+    1ull, 10ull, 100ull, 1000ull, 10000ull, 100000ull, 1000000ull, 10000000ull,
+    100000000ull, 1000000000ull, 10000000000ull, 100000000000ull,
+    1000000000000ull, 10000000000000ull, 100000000000000ull,
+    1000000000000000ull, 10000000000000000ull, 100000000000000000ull,
+    1000000000000000000ull, 10000000000000000000ull};
+
+inline size_t DecimalDigits(uint64_t value) {
+  // log10(2) ~ 1233 / 4096; `| 1` makes zero one digit long
+  size_t guess = (std::bit_width(value | 1) * 1233) >> 12;
+  return guess + ((value | 1) >= kPowersOf10[guess]);
+}
+
+// Writes `value` right-aligned so that its last digit is at end[-1].
+inline void WriteDigits(char* end, uint64_t value) {
+  while (value >= 100) {
+    end -= 2;
+    std::memcpy(end, kDigitPairs + value % 100 * 2, 2);
+    value /= 100;
+  }
+  if (value >= 10) {
+    std::memcpy(end - 2, kDigitPairs + value * 2, 2);
+  } else {
+    end[-1] = static_cast<char>('0' + value);
+  }
+}
+
+// Accumulates text in one growing buffer, formatting numbers straight into
+// it, and hands the buffer to a String with release(), without a copy.
+// Any type with a `template <typename Sink> AppendTo(Sink&)` member (such as
+// BigInteger and Rational) formats itself through the same appends.
+template <typename Alloc = std::allocator<char>,
+          typename Growth = DoublingGrowth>
+class BasicStringBuilder {
+ private:
+  static constexpr size_t kFloatSize = 32;  // longest shortest-form double
+
+  BasicString<Alloc, Growth> buffer_;
+
+  // Makes room for `count` more characters and returns where they go.
+  char* Reserve(size_t count) {
+    if (buffer_.capacity_ - buffer_.size_ < count) {
+      buffer_.Reallocate(
+          Growth::Next(buffer_.capacity_, buffer_.size_ + count));
+    }
+    return buffer_.elements + buffer_.size_;
+  }
+
+  void Commit(char* end) {
+    buffer_.size_ = end - buffer_.elements;
+    *end = '\0';
+  }
+
+  char* Extend(size_t count) {
+    char* out = Reserve(count);
+    Commit(out + count);
+    return out;
+  }
+
+ public:
+  BasicStringBuilder() requires(std::is_default_constructible_v<Alloc>) {}
+  explicit BasicStringBuilder(const Alloc& alloc) : buffer_(alloc) {}
+
+  size_t size() const { return buffer_.size(); }
+  StringView view() const { return buffer_; }
+  void reserve(size_t capacity) { buffer_.reserve(capacity); }
+  void clear() { buffer_.clear(); }
+
+  // Leaves the builder empty.
+  BasicString<Alloc, Growth> release() { return std::move(buffer_); }
+
+  BasicStringBuilder& append(char symb) {
+    *Extend(1) = symb;
+    return *this;
+  }
+  BasicStringBuilder& append(StringView str) {
+    std::memcpy(Extend(str.size()), str.data(), str.size());
+    return *this;
+  }
+  template <std::integral T>
+  BasicStringBuilder& append(T value) {
+    uint64_t magnitude = value;
+    bool negative = false;
+    if constexpr (std::is_signed_v<T>) {
+      if (value < 0) {
+        negative = true;
+        magnitude = 0 - magnitude;
+      }
+    }
+    size_t digits = DecimalDigits(magnitude);
+    char* out = Extend(negative + digits);
+    *out = '-';
+    WriteDigits(out + negative + digits, magnitude);
+    return *this;
+  }
+  // Zero-padded on the left to at least `width` digits.
+  BasicStringBuilder& append_padded(uint64_t value, size_t width) {
+    size_t digits = DecimalDigits(value);
+    size_t count = std::max(digits, width);
+    char* out = Extend(count);
+    std::memset(out, '0', count - digits);
+    WriteDigits(out + count, value);
+    return *this;
+  }
+  // Shortest form that reads back as the same value.
+  template <std::floating_point T>
+  BasicStringBuilder& append(T value) {
+    char* out = Reserve(kFloatSize);
+    Commit(std::to_chars(out, out + kFloatSize, value).ptr);
+    return *this;
+  }
+  template <std::floating_point T>
+  BasicStringBuilder& append(T value, std::chars_format format,
+                             int precision) {
+    size_t room = kFloatSize + std::max(precision, 0);
+    while (true) {
+      char* out = Reserve(room);
+      auto [end, error] = std::to_chars(out, out + room, value, format,
+                                        precision);
+      if (error == std::errc()) {
+        Commit(end);
+        return *this;
+      }
+      room *= 2;
+    }
+  }
+  template <typename T>
+    requires requires(T& value, BasicStringBuilder& out) {
+      value.AppendTo(out);
+    }
+  BasicStringBuilder& append(T&& value) {
+    value.AppendTo(*this);
+    return *this;
+  }
+
+  template <typename T>
+  BasicStringBuilder& operator<<(T&& value) {
+    return append(std::forward<T>(value));
+  }
+};
+
+using StringBuilder = BasicStringBuilder<>;
+
+struct InternEntry {
+  size_t hash;
+  String value;
+};
+
+// Handle to a string interned in a StringPool. Equal contents from the same
+// pool always give the same entry, so equality is a pointer compare. A
+// default Atom refers to nothing and equals only other default Atoms.
+class Atom {
+ private:
+  const InternEntry* entry_ = nullptr;
+
+ public:
+  Atom() {}
+  explicit Atom(const InternEntry* entry) : entry_(entry) {}
+
+  bool null() const { return entry_ == nullptr; }
+  size_t hash() const { return entry_ == nullptr ? 0 : entry_->hash; }
+  size_t size() const { return entry_ == nullptr ? 0 : entry_->value.size(); }
+  const char* data() const {
+    return entry_ == nullptr ? "" : entry_->value.data();
+  }
+  StringView view() const { return StringView(data(), size()); }
+  operator StringView() const { return view(); }
+
+  friend bool operator==(Atom first, Atom second) {
+    return first.entry_ == second.entry_;
+  }
+  friend bool operator!=(Atom first, Atom second) {
+    return first.entry_ != second.entry_;
+  }
+  friend bool operator<(Atom first, Atom second) {
+    return first.entry_ != second.entry_ && first.view() < second.view();
+  }
+};
+
+template <>
+struct std::hash<Atom> {
+  size_t operator()(Atom atom) const { return atom.hash(); }
+};
+
+// Thread-safe string deduplication. Lookups of already interned strings only
+// take a shared lock on one of kShards shards; entries never move or die
+// before the pool does, so Atoms stay valid for its whole lifetime.
+class StringPool {
+ private:
+  static constexpr size_t kShards = 16;
+  static constexpr size_t kInitialSlots = 64;
+
+  struct Shard {
+    mutable std::shared_mutex mutex;
+    std::deque<InternEntry> entries;
+    std::vector<InternEntry*> slots;  // open addressing, power-of-two size
+  };
+
+  Shard shards_[kShards];
+
+  Shard& ShardFor(size_t hash) { return shards_[(hash >> 56) % kShards]; }
+  const Shard& ShardFor(size_t hash) const {
+    return shards_[(hash >> 56) % kShards];
+  }
+
+  static InternEntry* Probe(const Shard& shard, StringView str, size_t hash) {
+    if (shard.slots.empty()) {
+      return nullptr;
+    }
+    size_t mask = shard.slots.size() - 1;
+    for (size_t i = hash & mask;; i = (i + 1) & mask) {
+      InternEntry* entry = shard.slots[i];
+      if (entry == nullptr) {
+        return nullptr;
+      }
+      if (entry->hash == hash && StringView(entry->value) == str) {
+        return entry;
+      }
+    }
+  }
+
+  static void Place(std::vector<InternEntry*>& slots, InternEntry* entry) {
+    size_t mask = slots.size() - 1;
+    size_t i = entry->hash & mask;
+    while (slots[i] != nullptr) {
+      i = (i + 1) & mask;
+    }
+    slots[i] = entry;
+  }
+
+  static void Grow(Shard& shard) {
+    std::vector<InternEntry*> slots(
+        std::max(kInitialSlots, 2 * shard.slots.size()), nullptr);
+    for (InternEntry& entry : shard.entries) {
+      Place(slots, &entry);
+    }
+    shard.slots.swap(slots);
+  }
+
+  Atom Intern(StringView str, size_t hash) {
+    Shard& shard = ShardFor(hash);
+    {
+      std::shared_lock<std::shared_mutex> lock(shard.mutex);
+      if (InternEntry* entry = Probe(shard, str, hash)) {
+        return Atom(entry);
+      }
+    }
+    std::unique_lock<std::shared_mutex> lock(shard.mutex);
+    if (InternEntry* entry = Probe(shard, str, hash)) {
+      return Atom(entry);
+    }
+    if (2 * (shard.entries.size() + 1) > shard.slots.size()) {
+      Grow(shard);
+    }
+    shard.entries.push_back(InternEntry{hash, String(str)});
+    Place(shard.slots, &shard.entries.back());
+    return Atom(&shard.entries.back());
+  }
+
+  Atom Find(StringView str, size_t hash) const {
+    const Shard& shard = ShardFor(hash);
+    std::shared_lock<std::shared_mutex> lock(shard.mutex);
+    return Atom(Probe(shard, str, hash));
+  }
+
+ public:
+  StringPool() {}
+  StringPool(const StringPool& other) = delete;
+  StringPool& operator=(const StringPool& other) = delete;
+
+  Atom intern(StringView str) {
+    return Intern(str, HashBytes(str.data(), str.size()));
+  }
+  Atom intern(StringLiteral str) { return Intern(str, str.hash()); }
+
+  // Return a null Atom if `str` has not been interned.
+  Atom find(StringView str) const {
+    return Find(str, HashBytes(str.data(), str.size()));
+  }
+  Atom find(StringLiteral str) const { return Find(str, str.hash()); }
+
+  size_t size() const {
+    size_t count = 0;
+    for (const Shard& shard : shards_) {
+      std::shared_lock<std::shared_mutex> lock(shard.mutex);
+      count += shard.entries.size();
+    }
+    return count;
+  }
+
+  // Bytes held by the pool: entries, slot tables and out-of-line contents.
+  size_t memory_usage() const {
+    size_t bytes = sizeof(*this);
+    for (const Shard& shard : shards_) {
+      std::shared_lock<std::shared_mutex> lock(shard.mutex);
+      bytes += shard.entries.size() * sizeof(InternEntry) +
+               shard.slots.capacity() * sizeof(InternEntry*);
+      for (const InternEntry& entry : shard.entries) {
+        if (!entry.value.IsSmall()) {
+          bytes += entry.value.capacity_ + 1;
+        }
+      }
+    }
+    return bytes;
+  }
+};
+
+struct RopeNode {
+  std::shared_ptr<const String> chunk;
+  size_t offset;  // this node's slice of `chunk`
+  size_t count;
+  size_t length;  // characters in the whole subtree
+  size_t nodes;   // nodes in the whole subtree
+  std::shared_ptr<const RopeNode> left;
+  std::shared_ptr<const RopeNode> right;
+};
+
+class RopeChunkIterator {
+ private:
+  std::vector<const RopeNode*> path_;
+  const String* tail_ = nullptr;
+
+  void PushLeftSpine(const RopeNode* node) {
+    for (; node != nullptr; node = node->left.get()) {
+      path_.push_back(node);
+    }
+  }
+
+ public:
+  using difference_type = std::ptrdiff_t;
+  using iterator_category = std::forward_iterator_tag;
+  using pointer = const StringView*;
+  using reference = StringView;
+  using value_type = StringView;
+
+  RopeChunkIterator() {}
+  RopeChunkIterator(const RopeNode* root, const String& tail)
+      : tail_(tail.size() == 0 ? nullptr : &tail) {
+    PushLeftSpine(root);
+  }
+
+  StringView operator*() const {
+    if (path_.empty()) {
+      return StringView(*tail_);
+    }
+    const RopeNode* node = path_.back();
+    return StringView(node->chunk->data() + node->offset, node->count);
+  }
+
+  RopeChunkIterator& operator++() {
+    if (path_.empty()) {
+      tail_ = nullptr;
+    } else {
+      const RopeNode* node = path_.back();
+      path_.pop_back();
+      PushLeftSpine(node->right.get());
+    }
+    return *this;
+  }
+
+  RopeChunkIterator operator++(int) {
+    auto temp = *this;
+    ++*this;
+    return temp;
+  }
+
+  bool operator==(const RopeChunkIterator& other) const {
+    return path_ == other.path_ && tail_ == other.tail_;
+  }
+  bool operator!=(const RopeChunkIterator& other) const {
+    return !(*this == other);
+  }
+};
+
+class RopeChunkRange {
+ private:
+  const RopeNode* root_;
+  const String& tail_;
+
+ public:
+  RopeChunkRange(const RopeNode* root, const String& tail)
+      : root_(root), tail_(tail) {}
+  RopeChunkIterator begin() const { return RopeChunkIterator(root_, tail_); }
+  RopeChunkIterator end() const { return RopeChunkIterator(); }
+};
+
+// Persistent randomized tree of String slices (a cord). Nodes are immutable
+// and shared, so copies, concatenation, insertion and substr cost O(log n)
+// and never copy characters. Small appends collect in `tail_` and enter the
+// tree as one chunk.
+class Rope {
+ private:
+  using NodePtr = std::shared_ptr<const RopeNode>;
+  static constexpr size_t kChunkSize = 4096;
+
+  NodePtr root_;
+  String tail_;
+
+  static size_t Length(const NodePtr& node) {
+    return node == nullptr ? 0 : node->length;
+  }
+  static size_t Nodes(const NodePtr& node) {
+    return node == nullptr ? 0 : node->nodes;
+  }
+
+  static uint64_t Random() {
+    thread_local uint64_t state = 0x9E3779B97F4A7C15ull;
+    state ^= state << 13;
+    state ^= state >> 7;
+    state ^= state << 17;
+    return state;
+  }
+
+  static NodePtr Make(const std::shared_ptr<const String>& chunk,
+                      size_t offset, size_t count, const NodePtr& left,
+                      const NodePtr& right) {
+    return std::make_shared<const RopeNode>(
+        RopeNode{chunk, offset, count, Length(left) + count + Length(right),
+                 Nodes(left) + 1 + Nodes(right), left, right});
+  }
+
+  static NodePtr Leaf(std::shared_ptr<const String> chunk) {
+    size_t count = chunk->size();
+    return count == 0 ? nullptr : Make(chunk, 0, count, nullptr, nullptr);
+  }
+
+  // Picks the root with probability proportional to subtree size, which
+  // keeps the expected depth logarithmic even when a tree is merged with
+  // itself.
+  static NodePtr Merge(const NodePtr& first, const NodePtr& second) {
+    if (first == nullptr) {
+      return second;
+    }
+    if (second == nullptr) {
+      return first;
+    }
+    if (Random() % (first->nodes + second->nodes) < first->nodes) {
+      return Make(first->chunk, first->offset, first->count, first->left,
+                  Merge(first->right, second));
+    }
+    return Make(second->chunk, second->offset, second->count,
+                Merge(first, second->left), second->right);
+  }
+
+  // Splits `node` into its first `pos` characters and the rest.
+  static void Split(NodePtr node, size_t pos, NodePtr& left,
+                    NodePtr& right) {
+    if (pos == 0) {
+      left = nullptr;
+      right = node;
+      return;
+    }
+    if (pos >= Length(node)) {
+      left = node;
+      right = nullptr;
+      return;
+    }
+    size_t left_length = Length(node->left);
+    if (pos <= left_length) {
+      NodePtr rest;
+      Split(node->left, pos, left, rest);
+      right = Make(node->chunk, node->offset, node->count, rest, node->right);
+    } else if (pos >= left_length + node->count) {
+      NodePtr rest;
+      Split(node->right, pos - left_length - node->count, rest, right);
+      left = Make(node->chunk, node->offset, node->count, node->left, rest);
+    } else {
+      size_t cut = pos - left_length;
+      left = Merge(node->left,
+                   Make(node->chunk, node->offset, cut, nullptr, nullptr));
+      right = Merge(Make(node->chunk, node->offset + cut, node->count - cut,
+                         nullptr, nullptr),
+                    node->right);
+    }
+  }
+
+  void Seal() {
+    if (tail_.size() != 0) {
+      root_ = Merge(root_, Leaf(std::make_shared<const String>(
+                               std::move(tail_))));
+      tail_ = String();
+    }
+  }
+
+  // The whole rope as one tree, without touching `*this`.
+  NodePtr Tree() const {
+    if (tail_.size() == 0) {
+      return root_;
+    }
+    return Merge(root_, Leaf(std::make_shared<const String>(tail_)));
+  }
+
+  explicit Rope(NodePtr root) : root_(std::move(root)) {}
+
+ public:
+  Rope() {}
+  Rope(StringView str) { *this += str; }
+
+  size_t size() const { return Length(root_) + tail_.size(); }
+  size_t length() const { return size(); }
+  bool empty() const { return size() == 0; }
+
+  char operator[](size_t index) const {
+    const RopeNode* node = root_.get();
+    if (index >= Length(root_)) {
+      return tail_[index - Length(root_)];
+    }
+    while (true) {
+      size_t left_length = Length(node->left);
+      if (index < left_length) {
+        node = node->left.get();
+      } else if (index < left_length + node->count) {
+        return (*node->chunk)[node->offset + index - left_length];
+      } else {
+        index -= left_length + node->count;
+        node = node->right.get();
+      }
+    }
+  }
+
+  Rope& operator+=(StringView str) {
+    if (tail_.size() + str.size() <= kChunkSize) {
+      tail_ += str;
+    } else {
+      append(String(str));
+    }
+    return *this;
+  }
+
+  // Takes `str` over as a chunk without copying its characters.
+  void append(String&& str) {
+    Seal();
+    root_ = Merge(root_, Leaf(std::make_shared<const String>(std::move(str))));
+  }
+
+  Rope& operator+=(const Rope& other) {
+    Seal();
+    root_ = Merge(root_, other.Tree());
+    return *this;
+  }
+
+  void insert(size_t pos, const Rope& other) {
+    Seal();
+    NodePtr left, right;
+    Split(root_, pos, left, right);
+    root_ = Merge(Merge(left, other.Tree()), right);
+  }
+
+  void erase(size_t pos, size_t count) {
+    Seal();
+    NodePtr left, middle, right;
+    Split(root_, pos, left, right);
+    Split(right, count, middle, right);
+    root_ = Merge(left, right);
+  }
+
+  Rope substr(size_t start, size_t count) const {
+    NodePtr left, middle, right;
+    Split(Tree(), start, left, right);
+    Split(right, count, middle, right);
+    return Rope(middle);
+  }
+
+  RopeChunkRange chunks() const { return RopeChunkRange(root_.get(), tail_); }
+
+  // Copies the rope into one contiguous String with a single allocation.
+  String flatten() const {
+    String result(size(), '\0');
+    char* out = result.data();
+    for (StringView chunk : chunks()) {
+      std::copy(chunk.begin(), chunk.end(), out);
+      out += chunk.size();
+    }
+    return result;
+  }
+
+  friend Rope operator+(const Rope& first, const Rope& second) {
+    return Rope(Merge(first.Tree(), second.Tree()));
+  }
+};
+
+// Whitespace in the "C" locale: ' ' and '\t' through '\r'.
+bool IsSpace(char symb) {
+  return symb == ' ' || static_cast<unsigned char>(symb - '\t') < 5;
+}
+
+#ifdef STRING_X86_SIMD
+uint32_t SpaceMask(const char* data) {
+  __m128i block = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data));
+  __m128i blank = _mm_cmpeq_epi8(block, _mm_set1_epi8(' '));
+  __m128i control = _mm_cmpeq_epi8(
+      _mm_subs_epu8(_mm_sub_epi8(block, _mm_set1_epi8('\t')),
+                    _mm_set1_epi8(4)),
+      _mm_setzero_si128());
+  return _mm_movemask_epi8(_mm_or_si128(blank, control));
+}
+#endif
+
+// Index of the first byte in [data, data + size) that is (or, with
+// `space` false, is not) whitespace, or `size` if there is none.
+size_t FindSpaceClass(const char* data, size_t size, bool space) {
+  size_t i = 0;
+#ifdef STRING_X86_SIMD
+  for (; i + 16 <= size; i += 16) {
+    uint32_t mask = SpaceMask(data + i);
+    if (!space) {
+      mask ^= 0xFFFF;
+    }
+    if (mask != 0) {
+      return i + __builtin_ctz(mask);
+    }
+  }
+#endif
+  for (; i < size; ++i) {
+    if (IsSpace(data[i]) == space) {
+      return i;
+    }
+  }
+  return size;
+}
+
+// Splits a stream or an in-memory buffer into whitespace-separated tokens.
+// Streams are read kBlockSize bytes at a time and token boundaries are found
+// 16 bytes per step, so the per-character cost of operator>> disappears.
+// A StringView token stays valid only until the next call to next().
+class Tokenizer {
+ private:
+  static constexpr size_t kBlockSize = 1 << 16;
+
+  std::istream* stream_ = nullptr;
+  std::vector<char> buffer_;
+  const char* data_ = nullptr;
+  size_t begin_ = 0;  // unread bytes are data_[begin_, end_)
+  size_t end_ = 0;
+
+  // Keeps the unread bytes, grows the buffer if they fill it, and reads
+  // more. Returns false once nothing more can be read.
+  bool Refill() {
+    if (stream_ == nullptr || !*stream_) {
+      return false;
+    }
+    size_t unread = end_ - begin_;
+    std::copy(buffer_.data() + begin_, buffer_.data() + end_, buffer_.data());
+    if (unread == buffer_.size()) {
+      buffer_.resize(2 * buffer_.size());
+    }
+    stream_->read(buffer_.data() + unread, buffer_.size() - unread);
+    data_ = buffer_.data();
+    begin_ = 0;
+    end_ = unread + stream_->gcount();
+    return end_ != unread;
+  }
+
+ public:
+  explicit Tokenizer(std::istream& stream)
+      : stream_(&stream), buffer_(kBlockSize) {
+    data_ = buffer_.data();
+  }
+
+  // Tokens are views into `text`, which must outlive them.
+  explicit Tokenizer(StringView text)
+      : data_(text.data()), end_(text.size()) {}
+
+  bool next(StringView& token) {
+    while (true) {
+      begin_ += FindSpaceClass(data_ + begin_, end_ - begin_, false);
+      if (begin_ != end_) {
+        break;
+      }
+      if (!Refill()) {
+        return false;
+      }
+    }
+    size_t length = FindSpaceClass(data_ + begin_, end_ - begin_, true);
+    while (begin_ + length == end_ && Refill()) {
+      length += FindSpaceClass(data_ + begin_ + length, end_ - begin_ - length,
+                               true);
+    }
+    token = StringView(data_ + begin_, length);
+    begin_ += length;
+    return true;
+  }
+
+  // Reuses `token`'s buffer, so it allocates at most once per call.
+  template <typename Alloc, typename Growth>
+  bool next(BasicString<Alloc, Growth>& token) {
+    StringView view;
+    if (!next(view)) {
+      return false;
+    }
+    token.clear();
+    token += view;
+    return true;
+  }
+};
+
+// Aho-Corasick automaton compiled once from a set of patterns; it reports
+// every occurrence of every pattern in a single pass over the text. Bytes
+// that occur in no pattern share one class, and the complete transition
+// function is a dense state-by-class table, so scanning costs one lookup per
+// byte. Empty patterns are ignored.
+class MultiPatternMatcher {
+ private:
+  static constexpr uint32_t kNone = UINT32_MAX;
+
+  uint16_t byte_class_[256] = {};  // up to 257 classes
+  size_t classes_ = 1;
+  std::vector<uint32_t> transitions_;   // state * classes_ + class
+  std::vector<uint32_t> report_;        // nearest state on the suffix chain
+                                        // where some pattern ends, or kNone
+  std::vector<uint32_t> next_report_;   // the one after that
+  std::vector<uint32_t> output_begin_;  // patterns ending at state s are
+  std::vector<uint32_t> outputs_;       // outputs_[output_begin_[s]...]
+  std::vector<size_t> pattern_sizes_;
+
+  uint32_t AddState() {
+    transitions_.resize(transitions_.size() + classes_, kNone);
+    return transitions_.size() / classes_ - 1;
+  }
+
+  template <typename Callback>
+  void Report(uint32_t state, size_t end, Callback& on_match) const {
+    for (state = report_[state]; state != kNone; state = next_report_[state]) {
+      for (uint32_t i = output_begin_[state]; i < output_begin_[state + 1];
+           ++i) {
+        uint32_t pattern = outputs_[i];
+        on_match(static_cast<size_t>(pattern), end - pattern_sizes_[pattern]);
+      }
+    }
+  }
+
+ public:
+  // Feeds a text in arbitrary chunks; matches that straddle chunk borders are
+  // found, with positions counted from the start of the whole stream.
+  class Scanner {
+   private:
+    const MultiPatternMatcher* matcher_;
+    uint32_t state_ = 0;
+    size_t offset_ = 0;
+
+   public:
+    explicit Scanner(const MultiPatternMatcher& matcher) : matcher_(&matcher) {}
+
+    // Calls on_match(pattern_index, start_position) for every occurrence
+    // that ends inside `chunk`.
+    template <typename Callback>
+    void feed(StringView chunk, Callback&& on_match) {
+      const uint16_t* byte_class = matcher_->byte_class_;
+      const uint32_t* transitions = matcher_->transitions_.data();
+      const uint32_t* report = matcher_->report_.data();
+      size_t classes = matcher_->classes_;
+      uint32_t state = state_;
+      for (size_t i = 0; i < chunk.size(); ++i) {
+        state = transitions[state * classes +
+                            byte_class[static_cast<unsigned char>(chunk[i])]];
+        if (report[state] != kNone) {
+          matcher_->Report(state, offset_ + i + 1, on_match);
+        }
+      }
+      state_ = state;
+      offset_ += chunk.size();
+    }
+
+    void reset() {
+      state_ = 0;
+      offset_ = 0;
+    }
+  };
+
+  template <typename Container>
+  explicit MultiPatternMatcher(const Container& patterns) {
+    for (const auto& pattern : patterns) {
+      StringView view(pattern);
+      pattern_sizes_.push_back(view.size());
+      for (char symb : view) {
+        byte_class_[static_cast<unsigned char>(symb)] = 1;
+      }
+    }
+    for (size_t byte = 0; byte < 256; ++byte) {
+      if (byte_class_[byte] != 0) {
+        byte_class_[byte] = classes_++;
+      }
+    }
+
+    std::vector<std::vector<uint32_t>> ends;
+    AddState();
+    ends.emplace_back();
+    uint32_t index = 0;
+    for (const auto& pattern : patterns) {
+      StringView view(pattern);
+      if (!view.empty()) {
+        uint32_t state = 0;
+        for (char symb : view) {
+          uint32_t& next =
+              transitions_[state * classes_ +
+                           byte_class_[static_cast<unsigned char>(symb)]];
+          if (next == kNone) {
+            uint32_t created = AddState();  // may reallocate transitions_
+            ends.emplace_back();
+            transitions_[state * classes_ +
+                         byte_class_[static_cast<unsigned char>(symb)]] =
+                created;
+            state = created;
+          } else {
+            state = next;
+          }
+        }
+        ends[state].push_back(index);
+      }
+      ++index;
+    }
+
+    size_t states = ends.size();
+    std::vector<uint32_t> fail(states, 0);
+    report_.assign(states, kNone);
+    next_report_.assign(states, kNone);
+    std::vector<uint32_t> queue;
+    queue.reserve(states);
+    for (size_t c = 0; c < classes_; ++c) {
+      uint32_t& next = transitions_[c];
+      if (next == kNone) {
+        next = 0;
+      } else {
+        queue.push_back(next);
+      }
+    }
+    for (size_t head = 0; head < queue.size(); ++head) {
+      uint32_t state = queue[head];
+      next_report_[state] = report_[fail[state]];
+      report_[state] = ends[state].empty() ? next_report_[state] : state;
+      for (size_t c = 0; c < classes_; ++c) {
+        uint32_t& next = transitions_[state * classes_ + c];
+        uint32_t fallback = transitions_[fail[state] * classes_ + c];
+        if (next == kNone) {
+          next = fallback;
+        } else {
+          fail[next] = fallback;
+          queue.push_back(next);
+        }
+      }
+    }
+
+    output_begin_.reserve(states + 1);
+    for (const auto& list : ends) {
+      output_begin_.push_back(outputs_.size());
+      outputs_.insert(outputs_.end(), list.begin(), list.end());
+    }
+    output_begin_.push_back(outputs_.size());
+  }
+
+  MultiPatternMatcher(std::initializer_list<StringView> patterns)
+      : MultiPatternMatcher(std::vector<StringView>(patterns)) {}
+
+  size_t patterns() const { return pattern_sizes_.size(); }
+  size_t states() const { return report_.size(); }
+
+  template <typename Callback>
+  void scan(StringView text, Callback&& on_match) const {
+    Scanner scanner(*this);
+    scanner.feed(text, on_match);
+  }
+
+  bool contains_any(StringView text) const {
+    uint32_t state = 0;
+    for (char symb : text) {
+      state = transitions_[state * classes_ +
+                           byte_class_[static_cast<unsigned char>(symb)]];
+      if (report_[state] != kNone) {
+        return true;
+      }
+    }
+    return false;
+  }
+};
+
+#ifdef STRING_MMAP
+// Read-only view of a whole file mapped into memory: the String search and
+// comparison API without reading the file into a buffer. substr() returns
+// views into the mapping, which must not outlive the MappedFile. Searches
+// over large files split the file into blocks handed out to `threads`
+// workers (0 means one per hardware thread); results are in file order.
+class MappedFile {
+ private:
+  static constexpr size_t kBlockSize = size_t(16) << 20;
+
+  const char* data_ = "";
+  size_t size_ = 0;
+
+  void Unmap() {
+    if (size_ != 0) {
+      munmap(const_cast<char*>(data_), size_);
+    }
+  }
+
+  // Calls search(begin, end) for every block of the file, each once.
+  template <typename Search>
+  void ForEachBlock(size_t threads, bool backward, Search&& search) const {
+    size_t blocks = (size_ + kBlockSize - 1) / kBlockSize;
+    if (threads == 0) {
+      threads = std::max(1u, std::thread::hardware_concurrency());
+    }
+    threads = std::min(threads, blocks);
+    std::atomic<size_t> next(0);
+    auto worker = [&] {
+      for (size_t block; (block = next++) < blocks;) {
+        if (backward) {
+          block = blocks - 1 - block;
+        }
+        search(block * kBlockSize, std::min(size_, (block + 1) * kBlockSize));
+      }
+    };
+    std::vector<std::thread> pool;
+    for (size_t i = 1; i < threads; ++i) {
+      pool.emplace_back(worker);
+    }
+    worker();
+    for (std::thread& thread : pool) {
+      thread.join();
+    }
+  }
+
+  // Text in which occurrences starting in [begin, end) can be found.
+  StringView Window(size_t begin, size_t end, size_t pattern_size) const {
+    return StringView(data_ + begin,
+                      std::min(size_, end + pattern_size - 1) - begin);
+  }
+
+ public:
+  explicit MappedFile(const char* path) {
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) {
+      throw std::system_error(errno, std::generic_category(), path);
+    }
+    struct stat info;
+    if (fstat(fd, &info) != 0) {
+      int error = errno;
+      close(fd);
+      throw std::system_error(error, std::generic_category(), path);
+    }
+    if (info.st_size > 0) {
+      void* block = mmap(nullptr, info.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+      if (block == MAP_FAILED) {
+        int error = errno;
+        close(fd);
+        throw std::system_error(error, std::generic_category(), path);
+      }
+      madvise(block, info.st_size, MADV_SEQUENTIAL);
+      data_ = static_cast<const char*>(block);
+      size_ = info.st_size;
+    }
+    close(fd);
+  }
+
+  MappedFile(const MappedFile& other) = delete;
+  MappedFile& operator=(const MappedFile& other) = delete;
+
+  MappedFile(MappedFile&& other) : data_(other.data_), size_(other.size_) {
+    other.data_ = "";
+    other.size_ = 0;
+  }
+  MappedFile& operator=(MappedFile&& other) {
+    if (this != &other) {
+      Unmap();
+      data_ = std::exchange(other.data_, "");
+      size_ = std::exchange(other.size_, 0);
+    }
+    return *this;
+  }
+
+  ~MappedFile() { Unmap(); }
+
+  size_t length() const { return size_; }
+  size_t size() const { return size_; }
+  bool empty() const { return size_ == 0; }
+  const char* data() const { return data_; }
+  const char& operator[](size_t index) const { return data_[index]; }
+  const char* begin() const { return data_; }
+  const char* end() const { return data_ + size_; }
+  operator StringView() const { return StringView(data_, size_); }
+
+  StringView substr(size_t start, size_t count) const {
+    return StringView(data_ + start, count);
+  }
+
+  // Both return size() when there is no occurrence, like String.
+  size_t find(StringView str, size_t threads = 0) const {
+    if (str.empty() || size_ <= kBlockSize) {
+      return SearchForward(data_, size_, str.data(), str.size());
+    }
+    std::atomic<size_t> first(size_);
+    ForEachBlock(threads, false, [&](size_t begin, size_t end) {
+      if (begin >= first) {
+        return;  // an earlier block already matched
+      }
+      StringView window = Window(begin, end, str.size());
+      size_t found = window.find(str);
+      if (found == window.size()) {
+        return;
+      }
+      size_t current = first;
+      while (begin + found < current &&
+             !first.compare_exchange_weak(current, begin + found)) {
+      }
+    });
+    return first;
+  }
+  size_t rfind(StringView str, size_t threads = 0) const {
+    if (str.empty() || size_ <= kBlockSize) {
+      return SearchBackward(data_, size_, str.data(), str.size());
+    }
+    std::atomic<size_t> last(0);  // position + 1, 0 for none
+    ForEachBlock(threads, true, [&](size_t begin, size_t end) {
+      if (end <= last) {
+        return;
+      }
+      StringView window = Window(begin, end, str.size());
+      size_t found = window.rfind(str);
+      if (found == window.size()) {
+        return;
+      }
+      size_t current = last;
+      while (begin + found + 1 > current &&
+             !last.compare_exchange_weak(current, begin + found + 1)) {
+      }
+    });
+    return last == 0 ? size_ : last - 1;
+  }
+
+  // Start of every occurrence, overlapping ones included; an empty pattern
+  // gives none.
+  std::vector<size_t> find_all(StringView str, size_t threads = 0) const {
+    std::vector<size_t> result;
+    if (str.empty() || size_ == 0) {
+      return result;
+    }
+    std::vector<std::vector<size_t>> found((size_ - 1) / kBlockSize + 1);
+    ForEachBlock(threads, false, [&](size_t begin, size_t end) {
+      std::vector<size_t>& hits = found[begin / kBlockSize];
+      for (size_t pos = begin; pos < end; ++pos) {
+        StringView window = Window(pos, end, str.size());
+        size_t offset = window.find(str);
+        if (offset == window.size() || pos + offset >= end) {
+          break;
+        }
+        pos += offset;
+        hits.push_back(pos);
+      }
+    });
+    for (const std::vector<size_t>& hits : found) {
+      result.insert(result.end(), hits.begin(), hits.end());
+    }
+    return result;
+  }
+};
+#endif
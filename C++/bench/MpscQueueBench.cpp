@@ -0,0 +1,89 @@
+// Multi-producer throughput of MpscQueue against a mutex-guarded List;
+// build with
+//   g++ -std=c++20 -O2 -pthread MpscQueueBench.cpp
+// and run as `./a.out [producers] [items per producer]`. The lock-free
+// queue pays off once producers run on cores of their own.
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "../List.cpp"
+
+class MutexQueue {
+ private:
+  std::mutex mutex_;
+  List<long> list_;
+
+ public:
+  void push(long value) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    list_.push_back(value);
+  }
+
+  template <typename OutputIt>
+  size_t try_pop_batch(OutputIt out, size_t max) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    size_t count = 0;
+    for (; count < max && list_.size() != 0; ++count) {
+      *out = *list_.begin();
+      ++out;
+      list_.pop_front();
+    }
+    return count;
+  }
+};
+
+// Millions of items per second through `queue`, from `producers` threads
+// to one consumer draining batches of 64.
+template <typename Queue>
+double Throughput(int producers, long items) {
+  Queue queue;
+  std::vector<std::thread> threads;
+  auto start = std::chrono::steady_clock::now();
+  for (int p = 0; p < producers; ++p) {
+    threads.emplace_back([&queue, items, p] {
+      for (long i = 0; i < items; ++i) {
+        queue.push(p * items + i);
+      }
+    });
+  }
+  long buffer[64];
+  long received = 0;
+  long long sum = 0;
+  while (received < producers * items) {
+    size_t count = queue.try_pop_batch(buffer, 64);
+    for (size_t i = 0; i < count; ++i) {
+      sum += buffer[i];
+    }
+    received += count;
+    if (count == 0) {
+      std::this_thread::yield();
+    }
+  }
+  for (std::thread& thread : threads) {
+    thread.join();
+  }
+  std::chrono::duration<double> elapsed =
+      std::chrono::steady_clock::now() - start;
+  long long total = producers * items;
+  if (sum != total * (total - 1) / 2) {
+    std::fprintf(stderr, "lost items\n");
+    std::exit(1);
+  }
+  return total / elapsed.count() / 1e6;
+}
+
+int main(int argc, char** argv) {
+  int cores = std::max(2u, std::thread::hardware_concurrency());
+  int producers = argc > 1 ? std::atoi(argv[1]) : cores - 1;
+  long items = argc > 2 ? std::atol(argv[2]) : 2000000;
+  std::printf("%d producers x %ld items, %u hardware threads\n", producers,
+              items, std::thread::hardware_concurrency());
+  std::printf("MpscQueue          %7.2f Mitems/s\n",
+              Throughput<MpscQueue<long>>(producers, items));
+  std::printf("mutex + List       %7.2f Mitems/s\n",
+              Throughput<MutexQueue>(producers, items));
+}
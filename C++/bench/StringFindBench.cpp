@@ -0,0 +1,82 @@
+// String::find against the byte loop it replaced and std::string::find;
+// build with
+//   g++ -std=c++20 -O2 StringFindBench.cpp
+#include <chrono>
+#include <cstdio>
+#include <random>
+#include <string>
+
+#include "../String.cpp"
+
+// The loop String::find used before the search engine, on raw bytes.
+size_t NaiveFind(const char* text, size_t size, const char* pattern,
+                 size_t length) {
+  for (size_t i = 0; i + length <= size; ++i) {
+    if (text[i] != pattern[0]) {
+      continue;
+    }
+    size_t j = 1;
+    while (j < length && text[i + j] == pattern[j]) {
+      ++j;
+    }
+    if (j == length) {
+      return i;
+    }
+  }
+  return size;
+}
+
+// Best of `runs` timings of fn(), in milliseconds.
+template <typename Fn>
+double Measure(Fn fn, int runs = 5) {
+  double best = 1e300;
+  for (int run = 0; run < runs; ++run) {
+    auto start = std::chrono::steady_clock::now();
+    fn();
+    std::chrono::duration<double, std::milli> elapsed =
+        std::chrono::steady_clock::now() - start;
+    best = std::min(best, elapsed.count());
+  }
+  return best;
+}
+
+size_t sink = 0;
+
+void Run(const char* name, const std::string& text,
+         const std::string& pattern) {
+  String string(text.data(), text.size());
+  String needle(pattern.data(), pattern.size());
+  double ours = Measure([&] { sink += string.find(needle); });
+  double naive = Measure([&] {
+    sink += NaiveFind(text.data(), text.size(), pattern.data(),
+                      pattern.size());
+  });
+  double standard = Measure([&] { sink += text.find(pattern); });
+  std::printf("%-22s String %8.2f ms  naive %8.2f ms  std %8.2f ms\n", name,
+              ours, naive, standard);
+}
+
+int main() {
+  const size_t kLogSize = 8 << 20;
+  std::mt19937 rng(42);
+  const char kWords[][8] = {"GET", "POST", "200", "404", "INFO", "WARN",
+                            "user", "id", "=", "/api", "ms", "\n"};
+  std::string log;
+  while (log.size() < kLogSize) {
+    log += kWords[rng() % 12];
+    log += ' ';
+  }
+
+  Run("rare first byte", log, "#MISSING#");
+  Run("common first byte", log, " POST /api/v2 500");
+  std::string periodic(4 << 20, 'a');
+  Run("adversarial 4 MiB", periodic, std::string(1000, 'a') + "b");
+
+  String string(log.data(), log.size());
+  String needle(" POST /api/v2 500");
+  double ours = Measure([&] { sink += string.rfind(needle); });
+  double standard = Measure([&] { sink += log.rfind(" POST /api/v2 500"); });
+  std::printf("%-22s String %8.2f ms  std %8.2f ms\n", "rfind common",
+              ours, standard);
+  return sink == 42 ? 1 : 0;
+}
@@ -0,0 +1,147 @@
+// Standalone test for List::compact(); build with
+//   g++ -std=c++20 -fsanitize=address,undefined ListCompactTest.cpp
+#include <cassert>
+#include <cstdio>
+#include <new>
+#include <string>
+#include <vector>
+
+#include "../List.cpp"
+
+// std::allocator that throws bad_alloc once `budget` allocations are spent;
+// a negative budget never throws. Not splittable, so compact() allocates
+// node by node.
+static int budget = -1;
+
+template <typename T>
+struct FailingAllocator {
+  using value_type = T;
+
+  FailingAllocator() {}
+  template <typename U>
+  FailingAllocator(const FailingAllocator<U>&) {}
+
+  T* allocate(size_t count) {
+    if (budget == 0) {
+      throw std::bad_alloc();
+    }
+    if (budget > 0) {
+      --budget;
+    }
+    return std::allocator<T>().allocate(count);
+  }
+  void deallocate(T* ptr, size_t count) {
+    std::allocator<T>().deallocate(ptr, count);
+  }
+
+  bool operator==(const FailingAllocator&) const { return true; }
+};
+
+// Copyable only, so compact() has to copy; the copy numbered `left` throws.
+struct CopyBomb {
+  static int left;
+  std::string value;
+
+  CopyBomb(std::string value) : value(std::move(value)) {}
+  CopyBomb(const CopyBomb& other) : value(other.value) {
+    if (--left == 0) {
+      throw 1;
+    }
+  }
+};
+int CopyBomb::left = 0;
+
+template <typename L>
+std::vector<std::string> Values(const L& list) {
+  return std::vector<std::string>(list.begin(), list.end());
+}
+
+void TestThrowingAllocator() {
+  std::vector<std::string> expected;
+  List<std::string, FailingAllocator<std::string>> list;
+  for (int i = 0; i < 5; ++i) {
+    expected.push_back(std::string(32, 'a' + i));
+    list.push_back(expected.back());
+  }
+  budget = 3;
+  bool thrown = false;
+  try {
+    list.compact();
+  } catch (const std::bad_alloc&) {
+    thrown = true;
+  }
+  budget = -1;
+  assert(thrown);
+  assert(list.size() == 5 && Values(list) == expected);
+  list.compact();
+  assert(Values(list) == expected);
+}
+
+void TestThrowingCopy() {
+  List<CopyBomb> list;
+  for (int i = 0; i < 5; ++i) {
+    list.push_back(CopyBomb(std::to_string(i)));
+  }
+  CopyBomb::left = 3;
+  bool thrown = false;
+  try {
+    list.compact();
+  } catch (int) {
+    thrown = true;
+  }
+  assert(thrown && list.size() == 5);
+  int i = 0;
+  for (const CopyBomb& bomb : list) {
+    assert(bomb.value == std::to_string(i++));
+  }
+}
+
+void TestThrowingRelocate() {
+  List<std::string> list;
+  for (int i = 0; i < 5; ++i) {
+    list.push_back(std::to_string(i));
+  }
+  int calls = 0;
+  try {
+    list.compact([&calls](auto, auto) {
+      if (++calls == 2) {
+        throw 2;
+      }
+    });
+  } catch (int) {
+  }
+  assert(list.size() == 5);
+  int i = 0;
+  for (const std::string& value : list) {
+    assert(value == std::to_string(i++));
+  }
+}
+
+void TestStableHandles() {
+  using Alloc = StackAllocator<std::string, 1 << 14>;
+  StackStorage<1 << 14> storage;
+  List<std::string, Alloc> list{Alloc(storage)};
+  std::vector<List<std::string, Alloc>::iterator> handles;
+  for (int i = 0; i < 10; ++i) {
+    list.push_front(std::to_string(i));
+    handles.push_back(list.begin());
+  }
+  list.compact([&handles](auto from, auto to) {
+    for (auto& handle : handles) {
+      if (handle == from) {
+        handle = to;
+      }
+    }
+  });
+  for (int i = 0; i < 10; ++i) {
+    assert(*handles[i] == std::to_string(i));
+  }
+}
+
+int main() {
+  TestThrowingAllocator();
+  TestThrowingCopy();
+  TestThrowingRelocate();
+  TestStableHandles();
+  std::puts("ok");
+}
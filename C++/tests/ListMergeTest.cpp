@@ -0,0 +1,48 @@
+// Standalone test for List::merge() with a throwing comparator; build with
+//   g++ -std=c++20 -fsanitize=address,undefined ListMergeTest.cpp
+#include <cassert>
+#include <cstdio>
+#include <iterator>
+#include <stdexcept>
+
+#include "../List.cpp"
+
+// Less-than that throws on its `calls`-th use.
+struct ThrowingLess {
+  int* calls;
+
+  bool operator()(int first, int second) const {
+    if (--*calls == 0) {
+      throw std::runtime_error("comparison");
+    }
+    return first < second;
+  }
+};
+
+static void TestThrowingMerge() {
+  for (int limit = 1; limit < 16; ++limit) {
+    List<int> list;
+    List<int> other;
+    for (int value : {1, 4, 7, 10}) {
+      list.push_back(value);
+    }
+    for (int value : {0, 2, 3, 5, 6, 8, 9, 11}) {
+      other.push_back(value);
+    }
+    int calls = limit;
+    try {
+      list.merge(other, ThrowingLess{&calls});
+    } catch (const std::runtime_error&) {
+    }
+    assert(list.size() + other.size() == 12);
+    assert(static_cast<size_t>(std::distance(list.begin(), list.end())) ==
+           list.size());
+    assert(static_cast<size_t>(std::distance(other.begin(), other.end())) ==
+           other.size());
+  }
+}
+
+int main() {
+  TestThrowingMerge();
+  std::puts("ok");
+}
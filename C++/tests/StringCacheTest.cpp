@@ -0,0 +1,64 @@
+// Standalone test for the opt-in hash and UTF-8 caches of String; build
+// with
+//   g++ -std=c++20 -fsanitize=address,undefined StringCacheTest.cpp
+#include <cassert>
+#include <cstdio>
+
+#include "../String.cpp"
+
+String Cached(const char* text) {
+  String str(text);
+  str.cache_hash();
+  str.cache_utf8();
+  return str;
+}
+
+// Assigning a concatenation that does not fit replaces the buffer.
+void TestConcatAssignment() {
+  String str = Cached("short");
+  size_t old_hash = str.hash();
+  String left(40, 'l');
+  String right("\xc3\xa9 right");
+  str = left + right;
+  assert(str.caches_hash() && str.caches_utf8());
+  assert(str.hash() != old_hash);
+  assert(str.hash() == String(str).hash());
+  assert(str.is_valid_utf8() && str.code_point_count() == 47);
+
+  // the concatenation may contain the string itself
+  str = str + left;
+  assert(str.caches_hash() && str.caches_utf8());
+  assert(str.size() == 88 && str.code_point_count() == 87);
+}
+
+void TestShrinkToFit() {
+  String str = Cached("");
+  for (int i = 0; i < 100; ++i) {
+    str += 'x';
+  }
+  size_t hash = str.hash();
+  assert(str.code_point_count() == 100);
+  str.shrink_to_fit();
+  assert(str.caches_hash() && str.caches_utf8());
+  assert(str.hash() == hash && str.code_point_count() == 100);
+  str += "\xc3\xa9";
+  assert(str.hash() != hash && str.code_point_count() == 101);
+}
+
+void TestDisablingOneCache() {
+  String str = Cached("\xc3\xa9t\xc3\xa9");
+  size_t hash = str.hash();
+  assert(str.code_point_count() == 3);
+  str.cache_utf8(false);
+  assert(str.caches_hash() && !str.caches_utf8());
+  assert(str.hash() == hash);
+  str.cache_hash(false);
+  assert(!str.caches_hash() && str.hash() == hash);
+}
+
+int main() {
+  TestConcatAssignment();
+  TestShrinkToFit();
+  TestDisablingOneCache();
+  std::puts("ok");
+}
@@ -0,0 +1,76 @@
+// Standalone test for UnrolledList insertion of its own elements; build with
+//   g++ -std=c++20 -fsanitize=address,undefined UnrolledListTest.cpp
+#include <cassert>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+#include "../List.cpp"
+
+using Strings = UnrolledList<std::string, std::allocator<std::string>, 4>;
+
+static Strings Make(std::vector<std::string> values) {
+  Strings list;
+  for (auto& value : values) {
+    list.push_back(value);
+  }
+  return list;
+}
+
+static bool Equal(const Strings& list, std::vector<std::string> expected) {
+  return list.size() == expected.size() &&
+         std::equal(list.begin(), list.end(), expected.begin());
+}
+
+static void TestPushFrontOwnBack() {
+  Strings list = Make({"aaaaaaaaaaaaaaaaaaaaaaaa", "b", "cccccccccccccccccc"});
+  list.push_front(list.back());
+  assert(Equal(list, {"cccccccccccccccccc", "aaaaaaaaaaaaaaaaaaaaaaaa", "b",
+                      "cccccccccccccccccc"}));
+}
+
+static void TestPushFrontOwnBackSplit() {
+  Strings list = Make({"a", "b", "c", "dddddddddddddddddddddddd"});
+  list.push_front(list.back());
+  assert(Equal(list, {"dddddddddddddddddddddddd", "a", "b", "c",
+                      "dddddddddddddddddddddddd"}));
+}
+
+static void TestInsertSameBlock() {
+  Strings list = Make({"a", "b", "cccccccccccccccccccccccc"});
+  auto pos = std::next(list.begin());
+  list.insert(pos, *std::next(pos));
+  assert(Equal(list, {"a", "cccccccccccccccccccccccc", "b",
+                      "cccccccccccccccccccccccc"}));
+}
+
+static void TestInsertSameBlockSplit() {
+  Strings list = Make({"a", "b", "c", "dddddddddddddddddddddddd"});
+  auto pos = list.begin();
+  list.insert(pos, *std::next(pos, 3));
+  assert(Equal(list, {"dddddddddddddddddddddddd", "a", "b", "c",
+                      "dddddddddddddddddddddddd"}));
+
+  list = Make({"aaaaaaaaaaaaaaaaaaaaaaaa", "b", "c", "d"});
+  pos = std::next(list.begin(), 3);
+  list.insert(pos, *list.begin());
+  assert(Equal(list, {"aaaaaaaaaaaaaaaaaaaaaaaa", "b", "c",
+                      "aaaaaaaaaaaaaaaaaaaaaaaa", "d"}));
+}
+
+static void TestPushBackOwnFront() {
+  Strings list = Make({"aaaaaaaaaaaaaaaaaaaaaaaa", "b", "c", "d"});
+  list.push_back(list.front());
+  list.push_back(list.front());
+  assert(Equal(list, {"aaaaaaaaaaaaaaaaaaaaaaaa", "b", "c", "d",
+                      "aaaaaaaaaaaaaaaaaaaaaaaa", "aaaaaaaaaaaaaaaaaaaaaaaa"}));
+}
+
+int main() {
+  TestPushFrontOwnBack();
+  TestPushFrontOwnBackSplit();
+  TestInsertSameBlock();
+  TestInsertSameBlockSplit();
+  TestPushBackOwnFront();
+  std::puts("ok");
+}